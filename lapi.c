@@ -53,16 +53,6 @@ const char lua_ident[] =
 #define isupvalue(i)		((i) < LUA_REGISTRYINDEX)
 
 
-/* Advance the garbage collector when creating large objects */
-static void advancegc (lua_State *L, size_t delta) {
-  delta >>= 5;  /* one object for each 32 bytes (empirical) */
-  if (delta > 0) {
-    global_State *g = G(L);
-    luaE_setdebt(g, g->GCdebt - cast(l_obj, delta));
-  }
-}
-
-
 /*
 ** Convert an acceptable index to a pointer to its respective value.
 ** Non-valid indices return the special nil value 'G(L)->nilvalue'.
@@ -540,7 +530,6 @@ LUA_API const char *lua_pushlstring (lua_State *L, const char *s, size_t len) {
   ts = (len == 0) ? luaS_new(L, "") : luaS_newlstr(L, s, len);
   setsvalue2s(L, L->top.p, ts);
   api_incr_top(L);
-  advancegc(L, len);
   luaC_checkGC(L);
   lua_unlock(L);
   return getstr(ts);
@@ -556,8 +545,6 @@ LUA_API const char *lua_pushextlstring (lua_State *L,
   ts = luaS_newextlstr (L, s, len, falloc, ud);
   setsvalue2s(L, L->top.p, ts);
   api_incr_top(L);
-  if (falloc != NULL)  /* non-static string? */
-    advancegc(L, len);  /* count its memory */
   luaC_checkGC(L);
   lua_unlock(L);
   return getstr(ts);
@@ -957,6 +944,90 @@ LUA_API void lua_rawseti (lua_State *L, int idx, lua_Integer n) {
 }
 
 
+LUA_API void lua_cleartable (lua_State *L, int idx) {
+  lua_lock(L);
+  luaH_clear(gettable(L, idx));
+  lua_unlock(L);
+}
+
+
+/*
+** {======================================================
+** Bulk raw operations over integer keys
+** (Not part of the API: they serve the fast paths of the table
+** library, which is part of the core. See 'lapi.h'.)
+** =======================================================
+*/
+
+void luaA_clonetable (lua_State *L, int idx) {
+  Table *src, *t;
+  lua_lock(L);
+  src = gettable(L, idx);
+  t = luaH_new(L);
+  sethvalue2s(L, L->top.p, t);
+  api_incr_top(L);
+  luaH_copy(L, t, src);
+  if (isblack(t))  /* aged during an emergency collection? */
+    luaC_barrierback_(L, obj2gco(t));
+  luaC_checkGC(L);
+  lua_unlock(L);
+}
+
+
+void luaA_rawfill (lua_State *L, int idx, lua_Integer i, lua_Integer j) {
+  Table *t;
+  TValue *v;
+  lua_lock(L);
+  api_checkpop(L, 1);
+  t = gettable(L, idx);
+  v = s2v(L->top.p - 1);
+  luaH_fill(L, t, i, j, v);
+  luaC_barrierback(L, obj2gco(t), v);
+  L->top.p--;
+  lua_unlock(L);
+}
+
+
+void luaA_rawreverse (lua_State *L, int idx, lua_Integer i,
+                                             lua_Integer j) {
+  lua_lock(L);
+  api_check(L, L->top.p < L->ci->top.p, "stack overflow");
+  luaH_reverse(L, gettable(L, idx), i, j);
+  lua_unlock(L);
+}
+
+
+void luaA_rawmove (lua_State *L, int from, lua_Integer f,
+                   lua_Integer e, int to, lua_Integer t) {
+  Table *src, *dst;
+  lua_lock(L);
+  src = gettable(L, from);
+  dst = gettable(L, to);
+  if (e >= f) {  /* otherwise, nothing to move */
+    lua_Integer n = l_castU2S(l_castS2U(e) - l_castS2U(f));
+    api_check(L, n >= 0 && t <= LUA_MAXINTEGER - n, "interval too large");
+    luaH_move(L, src, f, n, dst, t);
+    if (src != dst && isblack(dst))
+      luaC_barrierback_(L, obj2gco(dst));
+  }
+  lua_unlock(L);
+}
+
+
+int luaA_rawfind (lua_State *L, int idx, lua_Integer i,
+                  lua_Integer j, lua_Integer *pos) {
+  int res;
+  lua_lock(L);
+  api_checkpop(L, 1);
+  res = luaH_find(gettable(L, idx), i, j, s2v(L->top.p - 1), pos);
+  L->top.p--;
+  lua_unlock(L);
+  return res;
+}
+
+/* }====================================================== */
+
+
 LUA_API int lua_setmetatable (lua_State *L, int objindex) {
   TValue *obj;
   Table *mt;
@@ -1158,6 +1229,19 @@ LUA_API int lua_dump (lua_State *L, lua_Writer writer, void *data, int strip) {
 }
 
 
+/*
+** Dump a description of all live objects, calling 'writer' to write
+** its parts.
+*/
+LUA_API int lua_heapdump (lua_State *L, lua_Writer writer, void *data) {
+  int status;
+  lua_lock(L);
+  status = luaC_heapdump(L, writer, data);
+  lua_unlock(L);
+  return status;
+}
+
+
 LUA_API int lua_status (lua_State *L) {
   return L->status;
 }
@@ -1215,6 +1299,30 @@ LUA_API int lua_gc (lua_State *L, int what, ...) {
       res = gcrunning(g);
       break;
     }
+    case LUA_GCLIMIT: {
+      int limit = va_arg(argp, int);
+      res = cast_int(g->memlimit >> 10);
+      if (limit >= 0)  /* new limit? */
+        g->memlimit = cast(lu_mem, limit) << 10;  /* Kbytes to bytes */
+      break;
+    }
+    case LUA_GCPEAK: {
+      res = cast_int(g->peakbytes >> 10);
+      g->peakbytes = g->totalbytes;  /* start a new measurement */
+      break;
+    }
+    case LUA_GCDEFERFIN: {
+      int defer = va_arg(argp, int);
+      res = g->gcdeferfin;
+      if (defer >= 0)  /* new value? */
+        g->gcdeferfin = cast_byte(defer != 0);
+      break;
+    }
+    case LUA_GCRUNFIN: {
+      int n = va_arg(argp, int);
+      res = luaC_runfinalizers(L, n);
+      break;
+    }
     case LUA_GCGEN: {
       res = (g->gckind == KGC_INC) ? LUA_GCINC : LUA_GCGEN;
       luaC_changemode(L, KGC_GENMINOR);
@@ -1242,6 +1350,23 @@ LUA_API int lua_gc (lua_State *L, int what, ...) {
 }
 
 
+/*
+** Get the value of a collector statistic, optionally resetting it.
+** (Unlike 'lua_gc', it can be called from finalizers.)
+*/
+LUA_API lua_Integer lua_gcstat (lua_State *L, int stat, int reset) {
+  global_State *g = G(L);
+  lua_Integer res;
+  lua_lock(L);
+  api_check(L, 0 <= stat && stat < LUA_GCSN, "invalid statistic");
+  res = cast(lua_Integer, g->gcstats[stat]);
+  if (reset)
+    g->gcstats[stat] = 0;
+  lua_unlock(L);
+  return res;
+}
+
+
 
 /*
 ** miscellaneous functions
@@ -1356,7 +1481,6 @@ LUA_API void *lua_newuserdatauv (lua_State *L, size_t size, int nuvalue) {
   u = luaS_newudata(L, size, cast(unsigned short, nuvalue));
   setuvalue(L, s2v(L->top.p), u);
   api_incr_top(L);
-  advancegc(L, size);
   luaC_checkGC(L);
   lua_unlock(L);
   return getudatamem(u);
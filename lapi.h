@@ -62,4 +62,20 @@
                      L->tbclist.p < L->top.p - (n), \
 			  "not enough free elements in the stack")
 
+
+/*
+** Bulk raw operations over integer keys of tables, used by the table
+** library. They follow the conventions of the API (stack indices,
+** 'lua_lock'), but are internal to the core.
+*/
+LUAI_FUNC void luaA_clonetable (lua_State *L, int idx);
+LUAI_FUNC void luaA_rawfill (lua_State *L, int idx, lua_Integer i,
+                                                    lua_Integer j);
+LUAI_FUNC void luaA_rawreverse (lua_State *L, int idx, lua_Integer i,
+                                                       lua_Integer j);
+LUAI_FUNC void luaA_rawmove (lua_State *L, int from, lua_Integer f,
+                             lua_Integer e, int to, lua_Integer t);
+LUAI_FUNC int luaA_rawfind (lua_State *L, int idx, lua_Integer i,
+                            lua_Integer j, lua_Integer *pos);
+
 #endif
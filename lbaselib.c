@@ -14,6 +14,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "lua.h"
 
@@ -198,13 +199,49 @@ static int pushmode (lua_State *L, int oldmode) {
 */
 #define checkvalres(res) { if (res == -1) break; }
 
+
+/* options of 'collectgarbage' that are not options of 'lua_gc' */
+#define GCBUDGET	100
+#define GCSTATS		101
+
+
+/*
+** Do basic steps of the collector until the end of a cycle or until
+** it uses the given budget, in microseconds as measured by
+** 'luai_gcclock'. Returns whether the cycle ended and the time used.
+** When the clock is not available, does only one step. (A clock that
+** goes backwards, e.g. by wrapping around, ends the budget.)
+*/
+static int gcbudget (lua_State *L) {
+  lua_Integer budget = luaL_checkinteger(L, 2);
+  double start = luai_gcclock();
+  double used = 0;
+  int res;
+  luaL_argcheck(L, budget >= 0, 2, "negative budget");
+  do {
+    res = lua_gc(L, LUA_GCSTEP, 0);
+    if (res == -1) {  /* invalid call (inside a finalizer)? */
+      luaL_pushfail(L);
+      return 1;
+    }
+    if (start >= 0)  /* is there a clock? */
+      used = luai_gcclock() - start;
+  } while (!res && start >= 0 && 0 <= used && used < (double)budget);
+  lua_pushboolean(L, res);
+  lua_pushinteger(L, (used > 0) ? (lua_Integer)used : 0);
+  return 2;
+}
+
+
 static int luaB_collectgarbage (lua_State *L) {
   static const char *const opts[] = {"stop", "restart", "collect",
     "count", "step", "isrunning", "generational", "incremental",
-    "param", NULL};
+    "param", "budget", "limit", "peak", "stats",
+    "deferfinalizers", "runfinalizers", NULL};
   static const char optsnum[] = {LUA_GCSTOP, LUA_GCRESTART, LUA_GCCOLLECT,
     LUA_GCCOUNT, LUA_GCSTEP, LUA_GCISRUNNING, LUA_GCGEN, LUA_GCINC,
-    LUA_GCPARAM};
+    LUA_GCPARAM, GCBUDGET, LUA_GCLIMIT, LUA_GCPEAK, GCSTATS,
+    LUA_GCDEFERFIN, LUA_GCRUNFIN};
   int o = optsnum[luaL_checkoption(L, 1, "collect", opts)];
   switch (o) {
     case LUA_GCCOUNT: {
@@ -221,6 +258,31 @@ static int luaB_collectgarbage (lua_State *L) {
       lua_pushboolean(L, res);
       return 1;
     }
+    case GCBUDGET: {
+      return gcbudget(L);
+    }
+    case LUA_GCLIMIT: {
+      lua_Integer limit = luaL_optinteger(L, 2, -1);
+      int res;
+      luaL_argcheck(L, limit <= INT_MAX, 2, "limit too large");
+      res = lua_gc(L, o, (int)((limit < 0) ? -1 : limit));
+      checkvalres(res);
+      lua_pushinteger(L, res);
+      return 1;
+    }
+    case LUA_GCDEFERFIN: {
+      int res = lua_gc(L, o, lua_isnoneornil(L, 2) ? -1 : lua_toboolean(L, 2));
+      checkvalres(res);
+      lua_pushboolean(L, res);
+      return 1;
+    }
+    case LUA_GCRUNFIN: {
+      lua_Integer n = luaL_optinteger(L, 2, 0);
+      int res = lua_gc(L, o, (n <= 0 || n > INT_MAX) ? 0 : (int)n);
+      checkvalres(res);
+      lua_pushinteger(L, res);
+      return 1;
+    }
     case LUA_GCISRUNNING: {
       int res = lua_gc(L, o);
       checkvalres(res);
@@ -245,6 +307,18 @@ static int luaB_collectgarbage (lua_State *L) {
       lua_pushinteger(L, lua_gc(L, o, p, (int)value));
       return 1;
     }
+    case GCSTATS: {
+      static const char *const stats[] = {
+        "minor", "major", "marked", "freed", "freedbytes", "finalized"};
+      int reset = lua_toboolean(L, 2);
+      int i;
+      lua_createtable(L, 0, LUA_GCSN);
+      for (i = 0; i < LUA_GCSN; i++) {
+        lua_pushinteger(L, lua_gcstat(L, i, reset));
+        lua_setfield(L, -2, stats[i]);
+      }
+      return 1;
+    }
     default: {
       int res = lua_gc(L, o);
       checkvalres(res);
@@ -1359,6 +1359,69 @@ static int constfolding (FuncState *fs, int op, expdesc *e1,
 }
 
 
+/*
+** Try to "constant-fold" a comparison; return 1 iff successful. (In
+** this case, 'e1' has the final result.) Equality folds any two
+** constants, as they have no metamethods; order folds only numbers,
+** as the order of strings depends on the locale at run time. 'e1'
+** may have been turned into a 'VK' by 'luaK_infix'.
+*/
+static int foldcompare (FuncState *fs, BinOpr opr, expdesc *e1,
+                                       const expdesc *e2) {
+  lua_State *L = fs->ls->L;
+  TValue v1, v2;
+  int res;
+  if (e1->k == VK && !hasjumps(e1)) {
+    setobj(L, &v1, &fs->f->k[e1->u.info]);
+  }
+  else if (!tonumeral(e1, &v1))
+    return 0;
+  switch (opr) {
+    case OPR_EQ: case OPR_NE: {
+      if (!luaK_exp2const(fs, e2, &v2))
+        return 0;
+      res = (luaV_rawequalobj(&v1, &v2) == (opr == OPR_EQ));
+      break;
+    }
+    default: {
+      if (!ttisnumber(&v1) || !tonumeral(e2, &v2))
+        return 0;
+      switch (opr) {
+        case OPR_LT: res = luaV_lessthan(L, &v1, &v2); break;
+        case OPR_LE: res = luaV_lessequal(L, &v1, &v2); break;
+        case OPR_GT: res = luaV_lessthan(L, &v2, &v1); break;
+        case OPR_GE: res = luaV_lessequal(L, &v2, &v1); break;
+        default: lua_assert(0); return 0;
+      }
+      break;
+    }
+  }
+  e1->k = (res) ? VTRUE : VFALSE;
+  return 1;
+}
+
+
+/*
+** Fold the concatenation of string constants 'e1' and 'e2' into 'e1',
+** anchoring the result as the lexer does with strings from the source,
+** and release the register reserved for 'e1' by 'luaK_infix'.
+*/
+static void foldconcat (FuncState *fs, expdesc *e1, const expdesc *e2) {
+  LexState *ls = fs->ls;
+  lua_State *L = ls->L;
+  TString *ts;
+  luaD_checkstack(L, 2);
+  setsvalue2s(L, L->top.p, e1->u.strval);
+  setsvalue2s(L, L->top.p + 1, e2->u.strval);
+  L->top.p += 2;
+  luaV_concat(L, 2);  /* cannot call metamethods */
+  ts = tsvalue(s2v(L->top.p - 1));
+  e1->u.strval = luaX_newstring(ls, getstr(ts), tsslen(ts));
+  L->top.p--;  /* remove result */
+  freereg(fs, fs->freereg - 1);
+}
+
+
 /*
 ** Convert a BinOpr to an OpCode  (ORDER OPR - ORDER OP)
 */
@@ -1624,10 +1687,16 @@ void luaK_prefix (FuncState *fs, UnOpr opr, expdesc *e, int line) {
     case OPR_MINUS: case OPR_BNOT:  /* use 'ef' as fake 2nd operand */
       if (constfolding(fs, cast_int(opr + LUA_OPUNM), e, &ef))
         break;
-      /* else */ /* FALLTHROUGH */
-    case OPR_LEN:
       codeunexpval(fs, unopr2op(opr), e, line);
       break;
+    case OPR_LEN:
+      if (e->k == VKSTR && !hasjumps(e)) {  /* length of a string constant? */
+        e->u.ival = cast(lua_Integer, tsslen(e->u.strval));
+        e->k = VKINT;
+      }
+      else
+        codeunexpval(fs, unopr2op(opr), e, line);
+      break;
     case OPR_NOT: codenot(fs, e); break;
     default: lua_assert(0);
   }
@@ -1650,7 +1719,10 @@ void luaK_infix (FuncState *fs, BinOpr op, expdesc *v) {
       break;
     }
     case OPR_CONCAT: {
-      luaK_exp2nextreg(fs, v);  /* operand must be on the stack */
+      if (v->k == VKSTR && !hasjumps(v))  /* string constant? */
+        luaK_reserveregs(fs, 1);  /* keep it (it may be folded) */
+      else
+        luaK_exp2nextreg(fs, v);  /* operand must be on the stack */
       break;
     }
     case OPR_ADD: case OPR_SUB:
@@ -1672,23 +1744,51 @@ void luaK_infix (FuncState *fs, BinOpr op, expdesc *v) {
     }
     case OPR_LT: case OPR_LE:
     case OPR_GT: case OPR_GE: {
-      int dummy, dummy2;
-      if (!isSCnumber(v, &dummy, &dummy2))
+      if (!tonumeral(v, NULL))
         luaK_exp2anyreg(fs, v);
-      /* else keep numeral, which may be an immediate operand */
+      /* else keep numeral, which may be folded or used as an immediate
+         operand */
       break;
     }
     default: lua_assert(0);
   }
 }
 
+/*
+** Load string constant 'e1', kept by 'luaK_infix', into the register
+** reserved for it, just below 'e2'. When 'e2' is a concatenation, the
+** load takes the place of its CONCAT, which is coded again after it,
+** so that 'codeconcat' can still merge both CONCATs.
+*/
+static void concatK (FuncState *fs, expdesc *e1, expdesc *e2) {
+  int reg = e2->u.info - 1;
+  int k = stringK(fs, e1->u.strval);
+  Instruction *ie2 = previousinstruction(fs);
+  lua_assert(e2->k == VNONRELOC && reg == fs->freereg - 2);
+  if (GET_OPCODE(*ie2) == OP_CONCAT && k <= MAXARG_Bx) {
+    Instruction concat = *ie2;
+    int line = fs->previousline;  /* line of that CONCAT */
+    *ie2 = CREATE_ABx(OP_LOADK, reg, k);
+    luaK_code(fs, concat);
+    luaK_fixline(fs, line);
+  }
+  else
+    luaK_codek(fs, reg, k);
+  e1->k = VNONRELOC;
+  e1->u.info = reg;
+}
+
+
 /*
 ** Create code for '(e1 .. e2)'.
 ** For '(e1 .. e2.1 .. e2.2)' (which is '(e1 .. (e2.1 .. e2.2))',
 ** because concatenation is right associative), merge both CONCATs.
 */
 static void codeconcat (FuncState *fs, expdesc *e1, expdesc *e2, int line) {
-  Instruction *ie2 = previousinstruction(fs);
+  Instruction *ie2;
+  if (e1->k == VKSTR)  /* string constant kept by 'luaK_infix'? */
+    concatK(fs, e1, e2);
+  ie2 = previousinstruction(fs);
   if (GET_OPCODE(*ie2) == OP_CONCAT) {  /* is 'e2' a concatenation? */
     int n = GETARG_B(*ie2);  /* # of elements concatenated in 'e2' */
     lua_assert(e1->u.info + 1 == GETARG_A(*ie2));
@@ -1726,8 +1826,12 @@ void luaK_posfix (FuncState *fs, BinOpr opr,
       break;
     }
     case OPR_CONCAT: {  /* e1 .. e2 */
-      luaK_exp2nextreg(fs, e2);
-      codeconcat(fs, e1, e2, line);
+      if (e1->k == VKSTR && e2->k == VKSTR && !hasjumps(e2))
+        foldconcat(fs, e1, e2);
+      else {
+        luaK_exp2nextreg(fs, e2);
+        codeconcat(fs, e1, e2, line);
+      }
       break;
     }
     case OPR_ADD: case OPR_MUL: {
@@ -1767,16 +1871,20 @@ void luaK_posfix (FuncState *fs, BinOpr opr,
       break;
     }
     case OPR_EQ: case OPR_NE: {
-      codeeq(fs, opr, e1, e2);
+      if (!foldcompare(fs, opr, e1, e2))
+        codeeq(fs, opr, e1, e2);
       break;
     }
     case OPR_GT: case OPR_GE: {
+      if (foldcompare(fs, opr, e1, e2))
+        break;
       /* '(a > b)' <=> '(b < a)';  '(a >= b)' <=> '(b <= a)' */
       swapexps(e1, e2);
       opr = cast(BinOpr, (opr - OPR_GT) + OPR_LT);
     }  /* FALLTHROUGH */
     case OPR_LT: case OPR_LE: {
-      codeorder(fs, opr, e1, e2);
+      if (!foldcompare(fs, opr, e1, e2))
+        codeorder(fs, opr, e1, e2);
       break;
     }
     default: lua_assert(0);
@@ -1844,6 +1952,88 @@ static int finaltarget (Instruction *code, int i) {
 }
 
 
+/*
+** Line of instruction 'pc' in the function being finished. (Similar to
+** 'luaG_getfuncline', but the final sizes of the arrays are not set
+** yet.)
+*/
+static int getinstline (FuncState *fs, int pc) {
+  Proto *f = fs->f;
+  int i = fs->nabslineinfo - 1;
+  int basepc, line;
+  while (i >= 0 && f->abslineinfo[i].pc > pc)
+    i--;  /* find last absolute line information before 'pc' */
+  if (i < 0) {  /* no absolute information? */
+    basepc = -1;  /* start from the beginning */
+    line = f->linedefined;
+  }
+  else {
+    basepc = f->abslineinfo[i].pc;
+    line = f->abslineinfo[i].line;
+  }
+  while (basepc++ < pc)
+    line += f->lineinfo[basepc];
+  return line;
+}
+
+
+/*
+** Change the line of instruction 'pc' by 'dif', keeping the line of
+** instruction 'pc + 1'. Returns false if the new relative line
+** differences do not fit.
+*/
+static int shiftline (FuncState *fs, int pc, int dif) {
+  Proto *f = fs->f;
+  ls_byte *li = f->lineinfo;
+  if (li[pc] != ABSLINEINFO && abs(li[pc] + dif) >= LIMLINEDIFF)
+    return 0;
+  if (li[pc + 1] != ABSLINEINFO && abs(li[pc + 1] - dif) >= LIMLINEDIFF)
+    return 0;
+  if (li[pc] != ABSLINEINFO)
+    li[pc] = cast(ls_byte, li[pc] + dif);
+  else {  /* correct absolute information */
+    int i = fs->nabslineinfo - 1;
+    while (f->abslineinfo[i].pc != pc)
+      i--;
+    f->abslineinfo[i].line += dif;
+  }
+  if (li[pc + 1] != ABSLINEINFO)
+    li[pc + 1] = cast(ls_byte, li[pc + 1] - dif);
+  return 1;
+}
+
+
+/*
+** Try to replace the unconditional jump at 'pc' by a copy of its
+** (final) target, when that target is a return with a fixed number of
+** results: such a jump does only what the return does. The jump gets
+** the line of the return, so that hooks and tracebacks see the same
+** lines as before. The change is not done if the jump goes backward, is
+** part of a test, or if the new line information does not fit.
+*/
+static int jumptoreturn (FuncState *fs, int pc, int target) {
+  Proto *f = fs->f;
+  Instruction ret = f->code[target];
+  int dif;
+  switch (GET_OPCODE(ret)) {
+    case OP_RETURN0: case OP_RETURN1: break;
+    case OP_RETURN: {
+      if (GETARG_B(ret) == 0)  /* multiple results up to top? */
+        return 0;  /* depends on the previous instruction */
+      break;
+    }
+    default: return 0;
+  }
+  if (target <= pc || (pc > 0 && testTMode(GET_OPCODE(f->code[pc - 1]))))
+    return 0;
+  dif = getinstline(fs, target) - getinstline(fs, pc);
+  if (dif != 0 && !shiftline(fs, pc, dif))
+    return 0;
+  f->code[pc] = ret;
+  return 1;
+}
+
+
 /*
 ** Do a final pass over the code of a function, doing small peephole
 ** optimizations and adjustments.
@@ -1858,6 +2048,14 @@ void luaK_finish (FuncState *fs) {
     (void)luaP_isOT; (void)luaP_isIT;
     lua_assert(i == 0 || luaP_isOT(*(pc - 1)) == luaP_isIT(*pc));
     switch (GET_OPCODE(*pc)) {
+      case OP_JMP: {
+        int target = finaltarget(p->code, i);
+        if (!jumptoreturn(fs, i, target)) {
+          fixjump(fs, i, target);
+          break;
+        }
+        /* else jump became a return; adjust it as any other return */
+      }  /* FALLTHROUGH */
       case OP_RETURN0: case OP_RETURN1: {
         if (!(fs->needclose || (p->flag & PF_ISVARARG)))
           break;  /* no extra work */
@@ -1871,11 +2069,6 @@ void luaK_finish (FuncState *fs) {
           SETARG_C(*pc, p->numparams + 1);  /* signal that it is vararg */
         break;
       }
-      case OP_JMP: {
-        int target = finaltarget(p->code, i);
-        fixjump(fs, i, target);
-        break;
-      }
       default: break;
     }
   }
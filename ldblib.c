@@ -447,6 +447,24 @@ static int db_traceback (lua_State *L) {
 }
 
 
+static int heapwriter (lua_State *L, const void *b, size_t size, void *f) {
+  (void)L;  /* not used */
+  return (fwrite(b, 1, size, (FILE *)f) != size);
+}
+
+
+static int db_heapdump (lua_State *L) {
+  const char *fname = luaL_checkstring(L, 1);
+  FILE *f = fopen(fname, "w");
+  int ok;
+  if (f == NULL)
+    return luaL_fileresult(L, 0, fname);
+  ok = (lua_heapdump(L, heapwriter, f) == 0);
+  ok = (fclose(f) == 0) && ok;
+  return luaL_fileresult(L, ok, fname);
+}
+
+
 static const luaL_Reg dblib[] = {
   {"debug", db_debug},
   {"getuservalue", db_getuservalue},
@@ -464,6 +482,7 @@ static const luaL_Reg dblib[] = {
   {"setmetatable", db_setmetatable},
   {"setupvalue", db_setupvalue},
   {"traceback", db_traceback},
+  {"heapdump", db_heapdump},
   {NULL, NULL}
 };
 
@@ -9,6 +9,7 @@
 
 #include "lprefix.h"
 
+#include <stdio.h>
 #include <string.h>
 
 
@@ -242,6 +243,25 @@ void luaC_fix (lua_State *L, GCObject *o) {
 }
 
 
+/*
+** Weight of an object in the collector's accounting: one, plus the
+** extra weight of the contents of strings and userdata (see
+** 'luaC_addweight'). Long strings with fixed external contents do not
+** own them, so their contents do not count.
+*/
+static l_obj objweight (GCObject *o) {
+  switch (o->tt) {
+    case LUA_VLNGSTR: {
+      TString *ts = gco2ts(o);
+      return 1 + ((ts->shrlen == LSTRFIX) ? 0 : gcextraweight(ts->u.lnglen));
+    }
+    case LUA_VUSERDATA:
+      return 1 + gcextraweight(gco2u(o)->len);
+    default: return 1;
+  }
+}
+
+
 /*
 ** create a new collectable object (with given type, size, and offset)
 ** and link it to 'allgc' list.
@@ -290,7 +310,8 @@ GCObject *luaC_newobj (lua_State *L, lu_byte tt, size_t sz) {
 ** (only closures can), and a userdata's metatable must be a table.
 */
 static void reallymarkobject (global_State *g, GCObject *o) {
-  g->marked++;
+  g->marked += objweight(o);
+  g->gcstats[LUA_GCSMARKED]++;
   switch (o->tt) {
     case LUA_VSHRSTR:
     case LUA_VLNGSTR: {
@@ -447,7 +468,7 @@ static void traverseweakvalue (global_State *g, Table *h) {
   Node *n, *limit = gnodelast(h);
   /* if there is array part, assume it may have white values (it is not
      worth traversing it now just to check) */
-  int hasclears = (h->alimit > 0);
+  int hasclears = (h->asize > 0);
   for (n = gnode(h, 0); n < limit; n++) {  /* traverse hash part */
     if (isempty(gval(n)))  /* entry is empty? */
       clearkey(n);  /* clear its key */
@@ -469,7 +490,7 @@ static void traverseweakvalue (global_State *g, Table *h) {
 ** Traverse the array part of a table.
 */
 static int traversearray (global_State *g, Table *h) {
-  unsigned asize = luaH_realasize(h);
+  unsigned asize = h->asize;
   int marked = 0;  /* true if some object is marked in this traversal */
   unsigned i;
   for (i = 0; i < asize; i++) {
@@ -755,7 +776,7 @@ static l_obj clearbyvalues (global_State *g, GCObject *l, GCObject *f) {
     Table *h = gco2t(l);
     Node *n, *limit = gnodelast(h);
     unsigned int i;
-    unsigned int asize = luaH_realasize(h);
+    unsigned int asize = h->asize;
     for (i = 0; i < asize; i++) {
       GCObject *o = gcvalarr(h, i);
       if (iscleared(g, o))  /* value was collected? */
@@ -781,7 +802,9 @@ static void freeupval (lua_State *L, UpVal *uv) {
 
 
 static void freeobj (lua_State *L, GCObject *o) {
-  G(L)->totalobjs--;
+  global_State *g = G(L);
+  lu_mem inuse = g->totalbytes;
+  g->totalobjs -= objweight(o);
   switch (o->tt) {
     case LUA_VPROTO:
       luaF_freeproto(L, gco2p(o));
@@ -825,6 +848,8 @@ static void freeobj (lua_State *L, GCObject *o) {
     }
     default: lua_assert(0);
   }
+  g->gcstats[LUA_GCSFREED]++;
+  g->gcstats[LUA_GCSFREEDBYTES] += cast(l_obj, inuse - g->totalbytes);
 }
 
 
@@ -925,6 +950,7 @@ static void GCTM (lua_State *L) {
     lu_byte oldgcstp  = g->gcstp;
     g->gcstp |= GCSTPGC;  /* avoid GC steps */
     L->allowhook = 0;  /* stop debug hooks during GC metamethod */
+    g->gcstats[LUA_GCSFINALIZED]++;
     setobj2s(L, L->top.p++, tm);  /* push finalizer... */
     setobj2s(L, L->top.p++, &v);  /* ... and its argument */
     L->ci->callstatus |= CIST_FIN;  /* will run a finalizer */
@@ -950,6 +976,19 @@ static void callallpendingfinalizers (lua_State *L) {
 }
 
 
+/*
+** Call at most 'n' pending finalizers (all of them, if 'n' <= 0).
+** Returns the number of finalizers called.
+*/
+int luaC_runfinalizers (lua_State *L, int n) {
+  global_State *g = G(L);
+  int i;
+  for (i = 0; g->tobefnz != NULL && (n <= 0 || i < n); i++)
+    GCTM(L);
+  return i;
+}
+
+
 /*
 ** find last 'next' field in list 'p' list (to add elements in its end)
 */
@@ -1132,7 +1171,7 @@ static GCObject **sweepgen (lua_State *L, global_State *g, GCObject **p,
         lua_assert(age != G_OLD1);  /* advanced in 'markold' */
         setage(curr, nextage[age]);
         if (getage(curr) == G_OLD1) {
-          addedold++;  /* one more object becoming old */
+          addedold += objweight(curr);  /* one more object becoming old */
           if (*pfirstold1 == NULL)
             *pfirstold1 = curr;  /* first OLD1 object in the list */
         }
@@ -1225,7 +1264,7 @@ static void finishgencycle (lua_State *L, global_State *g) {
   correctgraylists(g);
   checkSizes(L, g);
   g->gcstate = GCSpropagate;  /* skip restart */
-  if (!g->gcemergency)
+  if (!g->gcemergency && !g->gcdeferfin)
     callallpendingfinalizers(L);
 }
 
@@ -1282,6 +1321,7 @@ static void youngcollection (lua_State *L, global_State *g) {
   markold(g, g->tobefnz, NULL);
 
   atomic(L);  /* will lose 'g->marked' */
+  g->gcstats[LUA_GCSMINOR]++;
 
   /* sweep nursery and get a pointer to its last live element */
   g->gcstate = GCSswpallgc;
@@ -1363,6 +1403,7 @@ static void entergen (lua_State *L, global_State *g) {
   luaC_runtilstate(L, GCSpause, 1);  /* prepare to start a new cycle */
   luaC_runtilstate(L, GCSpropagate, 1);  /* start new cycle */
   atomic(L);  /* propagates all and then do the atomic stuff */
+  g->gcstats[LUA_GCSMAJOR]++;
   atomic2gen(L, g);
   setminordebt(g);  /* set debt assuming next cycle will be minor */
 }
@@ -1569,6 +1610,7 @@ static l_obj singlestep (lua_State *L, int fast) {
     }
     case GCSenteratomic: {
       work = atomic(L);
+      g->gcstats[LUA_GCSMAJOR]++;
       if (checkmajorminor(L, g))
         entersweep(L);
       break;
@@ -1595,12 +1637,12 @@ static l_obj singlestep (lua_State *L, int fast) {
       break;
     }
     case GCScallfin: {  /* call finalizers */
-      if (g->tobefnz && !g->gcemergency) {
+      if (g->tobefnz && !g->gcemergency && !g->gcdeferfin) {
         g->gcstopem = 0;  /* ok collections during finalizers */
         GCTM(L);  /* call one finalizer */
         work = 1;
       }
-      else {  /* emergency mode or no more finalizers */
+      else {  /* emergency mode, deferred finalizers, or no more of them */
         g->gcstate = GCSpause;  /* finish collection */
         work = 0;
       }
@@ -1654,6 +1696,43 @@ static void incstep (lua_State *L, global_State *g) {
     luaE_setdebt(g, stepsize);
 }
 
+/*
+** When the memory in use is near its limit, the collector escalates.
+** In the near-limit range (the last 1/8 of the limit), steps get more
+** frequent: the debt for the next step is the step size scaled by the
+** fraction of that range still free. In the last 1/8 of that range, it
+** runs a (normal) full collection, once until memory leaves the range.
+** Beyond that, an allocation that would exceed the limit runs an
+** emergency collection (see 'lmem.c'). A warning signals when the
+** memory in use first gets near the limit.
+*/
+static void checkmemlimit (lua_State *L, global_State *g) {
+  if (nearmemlimit(g)) {
+    lu_mem range = g->memlimit / 8 + 1;  /* size of near-limit range */
+    lu_mem room = (g->totalbytes < g->memlimit)
+                ? g->memlimit - g->totalbytes : 0;
+    l_obj debt = applygcparam(g, STEPSIZE, 100);
+    if (g->gcnearlimit == 0) {
+      g->gcnearlimit = 1;
+      luaE_warning(L, "memory in use near its limit", 0);
+    }
+    if (room < range / 8 && g->gcnearlimit == 1) {  /* first time there? */
+      g->gcnearlimit = 2;
+      luaC_fullgc(L, 0);
+      if (!nearmemlimit(g))
+        return;  /* collection set a normal debt */
+      room = (g->totalbytes < g->memlimit)
+           ? g->memlimit - g->totalbytes : 0;
+    }
+    debt = debt * cast(l_obj, (room * 16) / range) / 16;
+    if (g->GCdebt > debt)  /* only brings next step closer */
+      luaE_setdebt(g, debt);
+  }
+  else
+    g->gcnearlimit = 0;
+}
+
+
 /*
 ** Performs a basic GC step if collector is running. (If collector is
 ** not running, set a reasonable debt to avoid it being called at
@@ -1674,6 +1753,7 @@ void luaC_step (lua_State *L) {
         setminordebt(g);
         break;
     }
+    checkmemlimit(L, g);
   }
 }
 
@@ -1722,3 +1802,211 @@ void luaC_fullgc (lua_State *L, int isemergency) {
 /* }====================================================== */
 
 
+
+
+/*
+** {======================================================
+** Heap dump
+** =======================================================
+*/
+
+typedef struct HeapDump {
+  lua_State *L;
+  lua_Writer writer;
+  void *data;
+  int status;
+} HeapDump;
+
+
+static void dumpstr (HeapDump *D, const char *s) {
+  if (D->status == 0)  /* no errors so far? */
+    D->status = (*D->writer)(D->L, s, strlen(s), D->data);
+}
+
+
+/* size for buffer space used by formatted addresses and sizes */
+#define DUMPBUFF	(3 * sizeof(void*) + 8)
+
+
+static void dumpref (HeapDump *D, const GCObject *o) {
+  if (o != NULL) {
+    char buff[DUMPBUFF];
+    l_sprintf(buff, sizeof(buff), " %p", cast_voidp(o));
+    dumpstr(D, buff);
+  }
+}
+
+
+#define dumpvalue(D,v)	dumpref(D, gcvalueN(v))
+
+/* dump a reference that can be NULL */
+#define dumpobj(D,t)	dumpref(D, ((t) == NULL) ? NULL : obj2gco(t))
+
+
+/*
+** Size in bytes of the memory owned by an object
+*/
+static size_t objsize (GCObject *o) {
+  switch (o->tt) {
+    case LUA_VTABLE: return luaH_size(gco2t(o));
+    case LUA_VUSERDATA: {
+      Udata *u = gco2u(o);
+      return sizeudata(u->nuvalue, u->len);
+    }
+    case LUA_VLCL: return sizeLclosure(gco2lcl(o)->nupvalues);
+    case LUA_VCCL: return sizeCclosure(gco2ccl(o)->nupvalues);
+    case LUA_VUPVAL: return sizeof(UpVal);
+    case LUA_VPROTO: {
+      Proto *f = gco2p(o);
+      size_t sz = sizeof(Proto) + cast_sizet(f->sizep) * sizeof(Proto*) +
+                  cast_sizet(f->sizek) * sizeof(TValue) +
+                  cast_sizet(f->sizelocvars) * sizeof(LocVar) +
+                  cast_sizet(f->sizeupvalues) * sizeof(Upvaldesc);
+      if (!(f->flag & PF_FIXED))  /* code and line info not fixed? */
+        sz += cast_sizet(f->sizecode) * sizeof(Instruction) +
+              cast_sizet(f->sizelineinfo) * sizeof(ls_byte) +
+              cast_sizet(f->sizeabslineinfo) * sizeof(AbsLineInfo);
+      return sz;
+    }
+    case LUA_VTHREAD: {
+      lua_State *th = gco2th(o);
+      return sizeof(lua_State) + cast_sizet(th->nci) * sizeof(CallInfo) +
+             cast_sizet(stacksize(th) + EXTRA_STACK) * sizeof(StackValue);
+    }
+    case LUA_VSHRSTR: return sizestrshr(cast_uint(gco2ts(o)->shrlen));
+    case LUA_VLNGSTR: {
+      TString *ts = gco2ts(o);
+      return luaS_sizelngstr(ts->u.lnglen, ts->shrlen);
+    }
+    default: lua_assert(0); return 0;
+  }
+}
+
+
+/*
+** Dump the references from an object, following what the traversal
+** functions mark. (Weak references are dumped too.)
+*/
+static void dumprefs (HeapDump *D, GCObject *o) {
+  int i;
+  switch (o->tt) {
+    case LUA_VTABLE: {
+      Table *h = gco2t(o);
+      unsigned j;
+      dumpobj(D, h->metatable);
+      for (j = 0; j < h->asize; j++)
+        dumpref(D, gcvalarr(h, j));
+      for (j = 0; j < allocsizenode(h); j++) {
+        Node *n = gnode(h, j);
+        if (!isempty(gval(n))) {
+          dumpref(D, gckeyN(n));
+          dumpvalue(D, gval(n));
+        }
+      }
+      break;
+    }
+    case LUA_VUSERDATA: {
+      Udata *u = gco2u(o);
+      dumpobj(D, u->metatable);
+      for (i = 0; i < u->nuvalue; i++)
+        dumpvalue(D, &u->uv[i].uv);
+      break;
+    }
+    case LUA_VLCL: {
+      LClosure *cl = gco2lcl(o);
+      dumpobj(D, cl->p);
+      for (i = 0; i < cl->nupvalues; i++)
+        dumpobj(D, cl->upvals[i]);
+      break;
+    }
+    case LUA_VCCL: {
+      CClosure *cl = gco2ccl(o);
+      for (i = 0; i < cl->nupvalues; i++)
+        dumpvalue(D, &cl->upvalue[i]);
+      break;
+    }
+    case LUA_VUPVAL: {
+      dumpvalue(D, gco2upv(o)->v.p);
+      break;
+    }
+    case LUA_VPROTO: {
+      Proto *f = gco2p(o);
+      dumpobj(D, f->source);
+      for (i = 0; i < f->sizek; i++)
+        dumpvalue(D, &f->k[i]);
+      for (i = 0; i < f->sizep; i++)
+        dumpobj(D, f->p[i]);
+      break;
+    }
+    case LUA_VTHREAD: {
+      lua_State *th = gco2th(o);
+      StkId s;
+      if (th->stack.p != NULL) {  /* stack already built? */
+        for (s = th->stack.p; s < th->top.p; s++)
+          dumpvalue(D, s2v(s));
+      }
+      break;
+    }
+    default: break;  /* strings have no references */
+  }
+}
+
+
+static void dumplist (HeapDump *D, global_State *g, GCObject *o) {
+  char buff[DUMPBUFF];
+  for (; o != NULL && D->status == 0; o = o->next) {
+    if (isdead(g, o))  /* not yet swept? */
+      continue;  /* ignore it */
+    l_sprintf(buff, sizeof(buff), "%p ", cast_voidp(o));
+    dumpstr(D, buff);
+    dumpstr(D, ttypename(novariant(o->tt)));
+    l_sprintf(buff, sizeof(buff), " " LUA_INTEGER_FMT,
+                                  cast(LUAI_UACINT, objsize(o)));
+    dumpstr(D, buff);
+    dumprefs(D, o);
+    dumpstr(D, "\n");
+  }
+}
+
+
+/*
+** Write a description of all live objects through 'writer', in text.
+** The first line lists the roots; each other line describes a live
+** object: its address, its type, its size, and the addresses of the
+** objects it refers to. The collector cannot run during the dump, so
+** that lists are not changed. Like an allocation function, 'writer'
+** runs inside the core: it must not call Lua nor raise errors, as
+** that would leave the collector stopped.
+*/
+int luaC_heapdump (lua_State *L, lua_Writer writer, void *data) {
+  global_State *g = G(L);
+  lu_byte oldgcstp = g->gcstp;
+  lu_byte oldgcstopem = g->gcstopem;
+  HeapDump D;
+  GCObject *o;
+  int i;
+  D.L = L;
+  D.writer = writer;
+  D.data = data;
+  D.status = 0;
+  g->gcstp |= GCSTPGC;  /* avoid GC steps */
+  g->gcstopem = 1;  /* and emergency collections */
+  dumpstr(&D, "roots");
+  dumpobj(&D, g->mainthread);
+  dumpvalue(&D, &g->l_registry);
+  for (i = 0; i < LUA_NUMTYPES; i++)
+    dumpobj(&D, g->mt[i]);
+  for (o = g->tobefnz; o != NULL; o = o->next)  /* being finalized */
+    dumpref(&D, o);
+  dumpstr(&D, "\n");
+  dumplist(&D, g, g->allgc);
+  dumplist(&D, g, g->finobj);
+  dumplist(&D, g, g->tobefnz);
+  dumplist(&D, g, g->fixedgc);
+  g->gcstopem = oldgcstopem;
+  g->gcstp = oldgcstp;
+  return D.status;
+}
+
+/* }====================================================== */
+
@@ -193,6 +193,19 @@
 #define LUAI_GCSTEPSIZE	250
 
 
+/*
+** The contents of strings and userdata count as one extra object for
+** each LUAI_GCUNIT bytes, so that large blocks pace the collector
+** according to their sizes.
+*/
+#define LUAI_GCUNIT	32
+
+#define gcextraweight(sz)	cast(l_obj, (sz) / LUAI_GCUNIT)
+
+/* count the extra weight of a new object with 'sz' bytes of contents */
+#define luaC_addweight(L,sz)	(G(L)->GCdebt -= gcextraweight(sz))
+
+
 #define setgcparam(g,p,v)  (g->gcparams[LUA_GCP##p] = luaO_codeparam(v))
 #define applygcparam(g,p,x)  luaO_applyparam(g->gcparams[LUA_GCP##p], x)
 
@@ -205,6 +218,15 @@
 #define gcrunning(g)	((g)->gcstp == 0)
 
 
+/*
+** Memory in use is near its limit when within 1/8 of it. Then, the
+** collector paces its steps by how close memory is to the limit (see
+** 'checkmemlimit').
+*/
+#define nearmemlimit(g)  ((g)->memlimit > 0 && \
+	(g)->totalbytes > (g)->memlimit - (g)->memlimit / 8)
+
+
 /*
 ** Does one step of collection when debt becomes zero. 'pre'/'pos'
 ** allows some adjustments to be done only when needed. macro
@@ -245,6 +267,8 @@ LUAI_FUNC void luaC_freeallobjects (lua_State *L);
 LUAI_FUNC void luaC_step (lua_State *L);
 LUAI_FUNC void luaC_runtilstate (lua_State *L, int state, int fast);
 LUAI_FUNC void luaC_fullgc (lua_State *L, int isemergency);
+LUAI_FUNC int luaC_runfinalizers (lua_State *L, int n);
+LUAI_FUNC int luaC_heapdump (lua_State *L, lua_Writer writer, void *data);
 LUAI_FUNC GCObject *luaC_newobj (lua_State *L, lu_byte tt, size_t sz);
 LUAI_FUNC GCObject *luaC_newobjdt (lua_State *L, lu_byte tt, size_t sz,
                                                  size_t offset);
@@ -58,6 +58,27 @@
 #define cantryagain(g)	(completestate(g) && !g->gcstopem)
 
 
+/*
+** An allocation that adds 'n' bytes and would take the memory in use
+** over the limit ('memlimit') fails on its first try. So, it will run
+** an emergency collection and then fail again if the collection did
+** not free enough memory. (Blocks that do not grow never fail.)
+*/
+#define overlimit(g,n)	((n) > 0 && (g)->memlimit > 0 && \
+	((n) > (g)->memlimit || (g)->totalbytes > (g)->memlimit - (n)))
+
+
+/*
+** After memory grows, update its maximum and, if it just got near the
+** limit, make the collector run at the next opportunity. (While memory
+** stays near the limit, 'luaC_step' paces the collector.)
+*/
+#define checkgrowth(g)  \
+	{ if ((g)->totalbytes > (g)->peakbytes) (g)->peakbytes = (g)->totalbytes; \
+	  if (!(g)->gcnearlimit && nearmemlimit(g) && (g)->GCdebt > 0) \
+	    luaE_setdebt(g, 0); }
+
+
 
 
 #if defined(EMERGENCYGCTESTS)
@@ -160,10 +181,12 @@ void luaM_free_ (lua_State *L, void *block, size_t osize) {
 ** collection to free some memory and then try the allocation again.
 */
 static void *tryagain (lua_State *L, void *block,
-                       size_t osize, size_t nsize) {
+                       size_t osize, size_t nsize, size_t inc) {
   global_State *g = G(L);
   if (cantryagain(g)) {
     luaC_fullgc(L, 1);  /* try to free some memory... */
+    if (overlimit(g, inc))  /* still not enough memory? */
+      return NULL;
     return callfrealloc(g, block, osize, nsize);  /* try again */
   }
   else return NULL;  /* cannot run an emergency collection */
@@ -176,15 +199,20 @@ static void *tryagain (lua_State *L, void *block,
 void *luaM_realloc_ (lua_State *L, void *block, size_t osize, size_t nsize) {
   void *newblock;
   global_State *g = G(L);
+  size_t inc = (nsize > osize) ? nsize - osize : 0;  /* memory added */
   lua_assert((osize == 0) == (block == NULL));
-  newblock = firsttry(g, block, osize, nsize);
+  if (l_unlikely(overlimit(g, inc)))
+    newblock = NULL;  /* do not even try */
+  else
+    newblock = firsttry(g, block, osize, nsize);
   if (l_unlikely(newblock == NULL && nsize > 0)) {
-    newblock = tryagain(L, block, osize, nsize);
+    newblock = tryagain(L, block, osize, nsize, inc);
     if (newblock == NULL)  /* still no memory? */
       return NULL;  /* do not update 'totalbytes' */
   }
   lua_assert((nsize == 0) == (newblock == NULL));
   g->totalbytes += nsize - osize;
+  checkgrowth(g);
   return newblock;
 }
 
@@ -203,13 +231,15 @@ void *luaM_malloc_ (lua_State *L, size_t size, int tag) {
     return NULL;  /* that's all */
   else {
     global_State *g = G(L);
-    void *newblock = firsttry(g, NULL, cast_sizet(tag), size);
+    void *newblock = (l_unlikely(overlimit(g, size))) ? NULL
+                   : firsttry(g, NULL, cast_sizet(tag), size);
     if (l_unlikely(newblock == NULL)) {
-      newblock = tryagain(L, NULL, cast_sizet(tag), size);
+      newblock = tryagain(L, NULL, cast_sizet(tag), size, size);
       if (newblock == NULL)
         luaM_error(L);
     }
     g->totalbytes += size;
+    checkgrowth(g);
     return newblock;
   }
 }
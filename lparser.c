@@ -1431,13 +1431,25 @@ static void restassign (LexState *ls, struct LHS_assign *lh, int nvars) {
 }
 
 
+/*
+** Code a test that skips what follows when condition 'v' is false;
+** return the list of jumps doing that skip. A condition that is always
+** false (e.g., a folded comparison) needs no test.
+*/
+static int skipiffalse (FuncState *fs, expdesc *v) {
+  if ((v->k == VNIL || v->k == VFALSE) && v->t == v->f)
+    return luaK_jump(fs);  /* always skip */
+  luaK_goiftrue(fs, v);
+  return v->f;
+}
+
+
 static int cond (LexState *ls) {
   /* cond -> exp */
   expdesc v;
   expr(ls, &v);  /* read condition */
   if (v.k == VNIL) v.k = VFALSE;  /* 'falses' are all equal here */
-  luaK_goiftrue(ls->fs, &v);
-  return v.f;
+  return skipiffalse(ls->fs, &v);
 }
 
 
@@ -1686,9 +1698,8 @@ static void test_then_block (LexState *ls, int *escapelist) {
       jf = luaK_jump(fs);
   }
   else {  /* regular case (not a break) */
-    luaK_goiftrue(ls->fs, &v);  /* skip over block if condition is false */
+    jf = skipiffalse(fs, &v);  /* skip over block if condition is false */
     enterblock(fs, &bl, 0);
-    jf = v.f;
   }
   statlist(ls);  /* 'then' part */
   leaveblock(fs);
@@ -275,10 +275,13 @@ typedef struct global_State {
   lua_Alloc frealloc;  /* function to reallocate memory */
   void *ud;         /* auxiliary data to 'frealloc' */
   lu_mem totalbytes;  /* number of bytes currently allocated */
+  lu_mem peakbytes;  /* maximum value of 'totalbytes' (since last reset) */
+  lu_mem memlimit;  /* maximum value allowed for 'totalbytes' (0: none) */
   l_obj totalobjs;  /* total number of objects allocated + GCdebt */
   l_obj GCdebt;  /* objects counted but not yet allocated */
   l_obj marked;  /* number of objects marked in a GC cycle */
   l_obj GCmajorminor;  /* auxiliary counter to control major-minor shifts */
+  l_obj gcstats[LUA_GCSN];  /* statistics (see 'lua_gcstat') */
   stringtable strt;  /* hash table for strings */
   TValue l_registry;
   TValue nilvalue;  /* a nil value */
@@ -290,6 +293,8 @@ typedef struct global_State {
   lu_byte gcstopem;  /* stops emergency collections */
   lu_byte gcstp;  /* control whether GC is running */
   lu_byte gcemergency;  /* true if this is an emergency collection */
+  lu_byte gcnearlimit;  /* memory near 'memlimit'? (2: did full GC) */
+  lu_byte gcdeferfin;  /* true if finalizers only run on demand */
   GCObject *allgc;  /* list of all collectable objects */
   GCObject **sweepgc;  /* current position of sweep in list */
   GCObject *finobj;  /* list of collectable objects with finalizers */
@@ -183,6 +183,7 @@ TString *luaS_createlngstrobj (lua_State *L, size_t l) {
   ts->shrlen = LSTRREG;  /* signals that it is a regular long string */
   ts->contents = cast_charp(ts) + offsetof(TString, falloc);
   ts->contents[l] = '\0';  /* ending 0 */
+  luaC_addweight(L, l);
   return ts;
 }
 
@@ -292,6 +293,7 @@ Udata *luaS_newudata (lua_State *L, size_t s, unsigned short nuvalue) {
   o = luaC_newobj(L, LUA_VUSERDATA, sizeudata(nuvalue, s));
   u = gco2u(o);
   u->len = s;
+  luaC_addweight(L, s);
   u->nuvalue = nuvalue;
   u->metatable = NULL;
   for (i = 0; i < nuvalue; i++)
@@ -349,6 +351,7 @@ TString *luaS_newextlstr (lua_State *L,
     }
     ne.ts->falloc = falloc;
     ne.ts->ud = ud;
+    luaC_addweight(L, len);  /* contents are owned by Lua */
   }
   ne.ts->shrlen = ne.kind;
   ne.ts->u.lnglen = len;
@@ -74,7 +74,7 @@ typedef union {
 ** MAXASIZEB is the maximum number of elements in the array part such
 ** that the size of the array fits in 'size_t'.
 */
-#define MAXASIZEB	(MAX_SIZET/(sizeof(Value) + 1))
+#define MAXASIZEB	((MAX_SIZET - sizeof(unsigned)) / (sizeof(Value) + 1))
 
 
 /*
@@ -268,57 +268,9 @@ static int equalkey (const TValue *k1, const Node *n2, int deadok) {
 
 
 /*
-** True if value of 'alimit' is equal to the real size of the array
-** part of table 't'. (Otherwise, the array part must be larger than
-** 'alimit'.)
+** Check whether an integer key is in the array part of a table.
 */
-#define limitequalsasize(t)	(isrealasize(t) || ispow2((t)->alimit))
-
-
-/*
-** Returns the real size of the 'array' array
-*/
-unsigned int luaH_realasize (const Table *t) {
-  if (limitequalsasize(t))
-    return t->alimit;  /* this is the size */
-  else {
-    unsigned int size = t->alimit;
-    /* compute the smallest power of 2 not smaller than 'size' */
-    size |= (size >> 1);
-    size |= (size >> 2);
-    size |= (size >> 4);
-    size |= (size >> 8);
-#if (UINT_MAX >> 14) > 3  /* unsigned int has more than 16 bits */
-    size |= (size >> 16);
-#if (UINT_MAX >> 30) > 3
-    size |= (size >> 32);  /* unsigned int has more than 32 bits */
-#endif
-#endif
-    size++;
-    lua_assert(ispow2(size) && size/2 < t->alimit && t->alimit < size);
-    return size;
-  }
-}
-
-
-/*
-** Check whether real size of the array is a power of 2.
-** (If it is not, 'alimit' cannot be changed to any other value
-** without changing the real size.)
-*/
-static int ispow2realasize (const Table *t) {
-  return (!isrealasize(t) || ispow2(t->alimit));
-}
-
-
-static unsigned int setlimittosize (Table *t) {
-  t->alimit = luaH_realasize(t);
-  setrealasize(t);
-  return t->alimit;
-}
-
-
-#define limitasasize(t)	check_exp(isrealasize(t), t->alimit)
+#define keyinarray(t,key)	(l_castS2U(key) - 1u < (t)->asize)
 
 
 
@@ -378,7 +330,7 @@ static unsigned findindex (lua_State *L, Table *t, TValue *key,
 
 
 int luaH_next (lua_State *L, Table *t, StkId key) {
-  unsigned int asize = luaH_realasize(t);
+  unsigned int asize = t->asize;
   unsigned int i = findindex(L, t, s2v(key), asize);  /* find original key */
   for (; i < asize; i++) {  /* try first array part */
     lu_byte tag = *getArrTag(t, i);
@@ -413,42 +365,6 @@ static void freehash (lua_State *L, Table *t) {
 }
 
 
-/*
-** Check whether an integer key is in the array part. If 'alimit' is
-** not the real size of the array, the key still can be in the array
-** part.  In this case, do the "Xmilia trick" to check whether 'key-1'
-** is smaller than the real size.
-** The trick works as follow: let 'p' be the integer such that
-** '2^(p+1) >= alimit > 2^p', or '2^(p+1) > alimit-1 >= 2^p'.  That is,
-** 'p' is the highest 1-bit in 'alimit-1', and 2^(p+1) is the real size
-** of the array. What we have to check becomes 'key-1 < 2^(p+1)'.  We
-** compute '(key-1) & ~(alimit-1)', which we call 'res'; it will have
-** the 'p' bit cleared. (It may also clear other bits smaller than 'p',
-** but no bit higher than 'p'.) If the key is outside the array, that
-** is, 'key-1 >= 2^(p+1)', then 'res' will have some 1-bit higher than
-** 'p', therefore it will be larger or equal to 'alimit', and the check
-** will fail. If 'key-1 < 2^(p+1)', then 'res' has no 1-bit higher than
-** 'p', and as the bit 'p' itself was cleared, 'res' will be smaller
-** than 2^p, therefore smaller than 'alimit', and the check succeeds.
-** As special cases, when 'alimit' is 0 the condition is trivially false,
-** and when 'alimit' is 1 the condition simplifies to 'key-1 < alimit'.
-** If key is 0 or negative, 'res' will have its higher bit on, so that
-** it cannot be smaller than 'alimit'.
-*/
-static int keyinarray (Table *t, lua_Integer key) {
-  lua_Unsigned alimit = t->alimit;
-  if (l_castS2U(key) - 1u < alimit)  /* 'key' in [1, t->alimit]? */
-    return 1;
-  else if (!isrealasize(t) &&  /* key still may be in the array part? */
-           (((l_castS2U(key) - 1u) & ~(alimit - 1u)) < alimit)) {
-    t->alimit = cast_uint(key);  /* probably '#t' is here now */
-    return 1;
-  }
-  else
-    return 0;
-}
-
-
 /*
 ** {=============================================================
 ** Rehash
@@ -512,7 +428,7 @@ static unsigned numusearray (const Table *t, unsigned *nums) {
   unsigned int ttlg;  /* 2^lg */
   unsigned int ause = 0;  /* summation of 'nums' */
   unsigned int i = 1;  /* count to traverse all array keys */
-  unsigned int asize = limitasasize(t);  /* real array size */
+  unsigned int asize = t->asize;
   /* traverse each slice */
   for (lg = 0, ttlg = 1; lg <= MAXABITS; lg++, ttlg *= 2) {
     unsigned int lc = 0;  /* counter */
@@ -556,7 +472,10 @@ static unsigned numusehash (const Table *t, unsigned *nums, unsigned *pna) {
 ** "concrete size" (number of bytes in the array).
 */
 static size_t concretesize (unsigned int size) {
-  return size * sizeof(Value) + size;  /* space for the two arrays */
+  if (size == 0)
+    return 0;
+  else  /* space for the two arrays plus the length hint */
+    return size * (sizeof(Value) + 1) + sizeof(unsigned);
 }
 
 
@@ -603,6 +522,25 @@ static Value *resizearray (lua_State *L , Table *t,
 }
 
 
+/*
+** Set all nodes of the hash part of a table as free.
+*/
+static void clearhash (Table *t) {
+  if (!isdummy(t)) {
+    unsigned i;
+    unsigned size = sizenode(t);
+    for (i = 0; i < size; i++) {
+      Node *n = gnode(t, i);
+      gnext(n) = 0;
+      setnilkey(n);
+      setempty(gval(n));
+    }
+    if (haslastfree(t))
+      getlastfree(t) = gnode(t, size);  /* all positions are free */
+  }
+}
+
+
 /*
 ** Creates an array for the hash part of a table with the given
 ** size, or reuses the dummy node if size is zero.
@@ -617,7 +555,6 @@ static void setnodevector (lua_State *L, Table *t, unsigned size) {
     setdummy(t);  /* signal that it is using dummy node */
   }
   else {
-    int i;
     int lsize = luaO_ceillog2(size);
     if (lsize > MAXHBITS || (1u << lsize) > MAXHSIZE)
       luaG_runerror(L, "table overflow");
@@ -628,16 +565,10 @@ static void setnodevector (lua_State *L, Table *t, unsigned size) {
       size_t bsize = size * sizeof(Node) + sizeof(Limbox);
       char *node = luaM_newblock(L, bsize);
       t->node = cast(Node *, node + sizeof(Limbox));
-      getlastfree(t) = gnode(t, size);  /* all positions are free */
     }
     t->lsizenode = cast_byte(lsize);
     setnodummy(t);
-    for (i = 0; i < cast_int(size); i++) {
-      Node *n = gnode(t, i);
-      gnext(n) = 0;
-      setnilkey(n);
-      setempty(gval(n));
-    }
+    clearhash(t);
   }
 }
 
@@ -663,9 +594,8 @@ static void reinsert (lua_State *L, Table *ot, Table *t) {
 
 /*
 ** Exchange the hash part of 't1' and 't2'. (In 'flags', only the
-** dummy bit must be exchanged: The 'isrealasize' is not related
-** to the hash part, and the metamethod bits do not change during
-** a resize, so the "real" table can keep their values.)
+** dummy bit must be exchanged: The metamethod bits do not change
+** during a resize, so the "real" table can keep their values.)
 */
 static void exchangehashpart (Table *t1, Table *t2) {
   lu_byte lsizenode = t1->lsizenode;
@@ -687,7 +617,7 @@ static void exchangehashpart (Table *t1, Table *t2) {
 static void reinsertOldSlice (lua_State *L, Table *t, unsigned oldasize,
                                             unsigned newasize) {
   unsigned i;
-  t->alimit = newasize;  /* pretend array has new size... */
+  t->asize = newasize;  /* pretend array has new size... */
   for (i = newasize; i < oldasize; i++) {  /* traverse vanishing slice */
     lu_byte tag = *getArrTag(t, i);
     if (!tagisempty(tag)) {  /* a non-empty entry? */
@@ -697,7 +627,7 @@ static void reinsertOldSlice (lua_State *L, Table *t, unsigned oldasize,
       luaH_setint(L, t, cast_int(i) + 1, &aux);
     }
   }
-  t->alimit = oldasize;  /* restore current size... */
+  t->asize = oldasize;  /* restore current size... */
 }
 
 
@@ -726,7 +656,7 @@ static void clearNewSlice (Table *t, unsigned oldasize, unsigned newasize) {
 void luaH_resize (lua_State *L, Table *t, unsigned newasize,
                                           unsigned nhsize) {
   Table newt;  /* to keep the new hash part */
-  unsigned int oldasize = setlimittosize(t);
+  unsigned int oldasize = t->asize;
   Value *newarray;
   if (newasize > MAXASIZE)
     luaG_runerror(L, "table overflow");
@@ -748,7 +678,9 @@ void luaH_resize (lua_State *L, Table *t, unsigned newasize,
   /* allocation ok; initialize new part of the array */
   exchangehashpart(t, &newt);  /* 't' has the new hash ('newt' has the old) */
   t->array = newarray;  /* set new array part */
-  t->alimit = newasize;
+  t->asize = newasize;
+  if (newasize > 0)
+    *lenhint(t) = newasize / 2u;  /* set an initial hint */
   clearNewSlice(t, oldasize, newasize);
   /* re-insert elements from old hash part into new parts */
   reinsert(L, &newt, t);  /* 'newt' now has the old hash */
@@ -771,7 +703,6 @@ static void rehash (lua_State *L, Table *t, const TValue *ek) {
   int i;
   unsigned totaluse;
   for (i = 0; i <= MAXABITS; i++) nums[i] = 0;  /* reset counts */
-  setlimittosize(t);
   na = numusearray(t, nums);  /* count keys in array part */
   totaluse = na;  /* all those keys are integer keys */
   totaluse += numusehash(t, nums, &na);  /* count keys in hash part */
@@ -798,7 +729,7 @@ Table *luaH_new (lua_State *L) {
   t->metatable = NULL;
   t->flags = maskflags;  /* table has no metamethod fields */
   t->array = NULL;
-  t->alimit = 0;
+  t->asize = 0;
   setnodevector(L, t, 0);
   return t;
 }
@@ -808,13 +739,179 @@ Table *luaH_new (lua_State *L) {
 ** Frees a table.
 */
 void luaH_free (lua_State *L, Table *t) {
-  unsigned int realsize = luaH_realasize(t);
   freehash(L, t);
-  resizearray(L, t, realsize, 0);
+  resizearray(L, t, t->asize, 0);
   luaM_free(L, t);
 }
 
 
+/*
+** Size in bytes of a table, including its array and hash parts.
+*/
+size_t luaH_size (Table *t) {
+  return sizeof(Table) + concretesize(t->asize) +
+         cast_sizet(allocsizenode(t)) * sizeof(Node);
+}
+
+
+/*
+** Removes all entries from a table, keeping the sizes of its array and
+** hash parts. (As all keys are removed, all nodes become free.)
+*/
+void luaH_clear (Table *t) {
+  if (t->asize > 0) {
+    clearNewSlice(t, 0, t->asize);  /* empty the whole array part */
+    *lenhint(t) = 0;
+  }
+  clearhash(t);
+}
+
+
+/*
+** {=============================================================
+** Bulk operations over integer keys
+** (All of them are raw; slots in the array part are handled directly.
+** The caller must take care of barriers for new values.)
+** ==============================================================
+*/
+
+/* raw value of t[k] (nil when absent) */
+static void getintval (Table *t, lua_Integer k, TValue *res) {
+  if (tagisempty(luaH_getint(t, k, res)))
+    setnilvalue(res);
+}
+
+
+/*
+** Copy 'src' into the empty table 't', with the same sizes.
+*/
+void luaH_copy (lua_State *L, Table *t, Table *src) {
+  unsigned asize = src->asize;
+  luaH_resize(L, t, asize, allocsizenode(src));
+  if (asize > 0)  /* copy array part as a block (values, hint, and tags) */
+    memcpy(t->array - asize, src->array - asize, concretesize(asize));
+  reinsert(L, src, t);
+}
+
+
+/*
+** t[i], ..., t[e] = v
+*/
+void luaH_fill (lua_State *L, Table *t, lua_Integer i, lua_Integer e,
+                                        TValue *v) {
+  while (i <= e) {
+    if (keyinarray(t, i)) {  /* fill the array slice in a tight loop */
+      lua_Unsigned last = keyinarray(t, e) ? l_castS2U(e) : t->asize;
+      unsigned k;
+      for (k = cast_uint(i - 1); k < last; k++)
+        obj2arr(t, k, v);
+      if (l_castS2U(e) == last)  /* done? */
+        break;
+      i = l_castU2S(last + 1u);  /* continue after the array part */
+    }
+    else {
+      luaH_setint(L, t, i, v);
+      if (i == e)
+        break;  /* avoid overflow in 'i++' */
+      i++;
+    }
+  }
+}
+
+
+/*
+** Reverse the order of t[i], ..., t[e]. Outside the array part, the
+** second assignment may create a key and then run a collection, when
+** the old t[i] is no longer in the table; so, it is kept on the stack
+** until then. (The caller must ensure one free stack slot.)
+*/
+void luaH_reverse (lua_State *L, Table *t, lua_Integer i, lua_Integer e) {
+  for (; i < e; i++, e--) {
+    if (keyinarray(t, i) && keyinarray(t, e)) {  /* swap array slots */
+      unsigned a = cast_uint(i - 1), b = cast_uint(e - 1);
+      lu_byte tag = *getArrTag(t, a);
+      Value v = *getArrVal(t, a);
+      *getArrTag(t, a) = *getArrTag(t, b);
+      *getArrVal(t, a) = *getArrVal(t, b);
+      *getArrTag(t, b) = tag;
+      *getArrVal(t, b) = v;
+    }
+    else {
+      TValue ve;
+      getintval(t, i, s2v(L->top.p));  /* anchor old t[i] */
+      L->top.p++;
+      getintval(t, e, &ve);
+      luaH_setint(L, t, i, &ve);  /* old t[e] still in the table */
+      luaH_setint(L, t, e, s2v(L->top.p - 1));
+      L->top.p--;
+    }
+  }
+}
+
+
+/* dst[d] = src[f] */
+static void moveint (lua_State *L, Table *src, lua_Integer f,
+                                   Table *dst, lua_Integer d) {
+  if (keyinarray(src, f) && keyinarray(dst, d)) {  /* copy slot */
+    *getArrTag(dst, cast_uint(d - 1)) = *getArrTag(src, cast_uint(f - 1));
+    *getArrVal(dst, cast_uint(d - 1)) = *getArrVal(src, cast_uint(f - 1));
+  }
+  else {
+    TValue v;
+    getintval(src, f, &v);
+    luaH_setint(L, dst, d, &v);
+  }
+}
+
+
+/*
+** dst[d], ..., dst[d + n] = src[f], ..., src[f + n], with the same
+** semantics as 'table.move' for overlapping intervals. The caller
+** ensures that the intervals do not wrap around.
+*/
+void luaH_move (lua_State *L, Table *src, lua_Integer f, lua_Integer n,
+                              Table *dst, lua_Integer d) {
+  lua_Integer k;
+  if (d > f + n || d <= f || src != dst) {  /* copy forward */
+    for (k = 0; k <= n; k++)
+      moveint(L, src, f + k, dst, d + k);
+  }
+  else {  /* overlap with destination after source; copy backward */
+    for (k = n; k >= 0; k--)
+      moveint(L, src, f + k, dst, d + k);
+  }
+}
+
+
+/*
+** Search for the first key 'k' in i, ..., e such that t[k] is raw
+** equal to 'v'. If found, sets '*pos' and returns 1; otherwise,
+** returns 0.
+*/
+int luaH_find (Table *t, lua_Integer i, lua_Integer e, const TValue *v,
+                         lua_Integer *pos) {
+  TValue w;
+  for (; i <= e; i++) {
+    if (keyinarray(t, i)) {
+      arr2obj(t, cast_uint(i - 1), &w);
+      if (isempty(&w))
+        setnilvalue(&w);  /* an empty slot is equal to nil */
+    }
+    else
+      getintval(t, i, &w);
+    if (luaV_rawequalobj(&w, v)) {
+      *pos = i;
+      return 1;
+    }
+    if (i == e)
+      break;  /* avoid overflow in 'i++' */
+  }
+  return 0;
+}
+
+/* }============================================================= */
+
+
 static Node *getfreepos (Table *t) {
   if (haslastfree(t)) {  /* does it have 'lastfree' information? */
     /* look for a spot before 'lastfree', updating 'lastfree' */
@@ -906,7 +1003,7 @@ static void luaH_newkey (lua_State *L, Table *t, const TValue *key,
 
 static const TValue *getintfromhash (Table *t, lua_Integer key) {
   Node *n = hashint(t, key);
-  lua_assert(l_castS2U(key) - 1u >= luaH_realasize(t));
+  lua_assert(!keyinarray(t, key));
   for (;;) {  /* check whether 'key' is somewhere in the chain */
     if (keyisinteger(n) && keyival(n) == key)
       return gval(n);  /* that's it */
@@ -1187,83 +1284,76 @@ static unsigned int binsearch (Table *array, unsigned int i, unsigned int j) {
 }
 
 
+/*
+** Set 'hint' as the length hint of table 't' and return it.
+*/
+static unsigned newhint (Table *t, unsigned hint) {
+  lua_assert(hint <= t->asize);
+  *lenhint(t) = hint;
+  return hint;
+}
+
+
 /*
 ** Try to find a boundary in table 't'. (A 'boundary' is an integer index
 ** such that t[i] is present and t[i+1] is absent, or 0 if t[1] is absent
 ** and 'maxinteger' if t[maxinteger] is present.)
 ** (In the next explanation, we use Lua indices, that is, with base 1.
 ** The code itself uses base 0 when indexing the array part of the table.)
-** The code starts with 'limit = t->alimit', a position in the array
-** part that may be a boundary.
-**
-** (1) If 't[limit]' is empty, there must be a boundary before it.
-** As a common case (e.g., after 't[#t]=nil'), check whether 'limit-1'
-** is present. If so, it is a boundary. Otherwise, do a binary search
-** between 0 and limit to find a boundary. In both cases, try to
-** use this boundary as the new 'alimit', as a hint for the next call.
-**
-** (2) If 't[limit]' is not empty and the array has more elements
-** after 'limit', try to find a boundary there. Again, try first
-** the special case (which should be quite frequent) where 'limit+1'
-** is empty, so that 'limit' is a boundary. Otherwise, check the
-** last element of the array part. If it is empty, there must be a
-** boundary between the old limit (present) and the last element
-** (absent), which is found with a binary search. (This boundary always
-** can be a new limit.)
-**
-** (3) The last case is when there are no elements in the array part
-** (limit == 0) or its last element (the new limit) is present.
-** In this case, must check the hash part. If there is no hash part
-** or 'limit+1' is absent, 'limit' is a boundary.  Otherwise, call
+** If there is an array part, the search starts at the length hint
+** kept in the array, which is the boundary found by the previous call.
+** Usual changes in a sequence ('t[#t+1]=v' or 't[#t]=nil') move the
+** boundary by only one position, so the code first looks for a
+** boundary in the vicinity of the hint. If that fails, it does a
+** binary search, either before the hint (when 't[hint]' is empty) or
+** after it (when the last element of the array is empty).
+** If there is no array part or its last element is present, the
+** boundary may be in the hash part. If there is no hash part or
+** 'asize+1' is absent, 'asize' is a boundary. Otherwise, call
 ** 'hash_search' to find a boundary in the hash part of the table.
 ** (In those cases, the boundary is not inside the array part, and
-** therefore cannot be used as a new limit.)
+** therefore cannot be used as a hint.)
 */
 lua_Unsigned luaH_getn (Table *t) {
-  unsigned int limit = t->alimit;
-  if (limit > 0 && arraykeyisempty(t, limit)) {  /* (1)? */
-    /* there must be a boundary before 'limit' */
-    if (limit >= 2 && !arraykeyisempty(t, limit - 1)) {
-      /* 'limit - 1' is a boundary; can it be a new limit? */
-      if (ispow2realasize(t) && !ispow2(limit - 1)) {
-        t->alimit = limit - 1;
-        setnorealasize(t);  /* now 'alimit' is not the real size */
+  unsigned asize = t->asize;
+  if (asize > 0) {  /* is there an array part? */
+    const unsigned maxvicinity = 4;
+    unsigned limit = *lenhint(t);  /* start with the hint */
+    unsigned i;
+    if (limit == 0)
+      limit = 1;  /* make 'limit' a valid index in the array */
+    if (arraykeyisempty(t, limit)) {  /* 't[limit]' is empty? */
+      /* there must be a boundary before 'limit' */
+      for (i = 0; i < maxvicinity && limit > 1; i++) {
+        limit--;
+        if (!arraykeyisempty(t, limit))
+          return newhint(t, limit);  /* 'limit' is a boundary */
       }
-      return limit - 1;
+      /* 't[limit]' still empty; search for a boundary in [0, limit) */
+      return newhint(t, binsearch(t, 0, limit));
     }
-    else {  /* must search for a boundary in [0, limit] */
-      unsigned int boundary = binsearch(t, 0, limit);
-      /* can this boundary represent the real size of the array? */
-      if (ispow2realasize(t) && boundary > luaH_realasize(t) / 2) {
-        t->alimit = boundary;  /* use it as the new limit */
-        setnorealasize(t);
+    else {  /* 'limit' is present; look for a boundary after it */
+      if (limit < asize && arraykeyisempty(t, limit + 1))
+        return limit;  /* hint is still a boundary; nothing to update */
+      for (i = 0; i < maxvicinity && limit < asize; i++) {
+        limit++;
+        if (arraykeyisempty(t, limit))
+          return newhint(t, limit - 1);  /* 'limit - 1' is a boundary */
+      }
+      if (arraykeyisempty(t, asize)) {  /* last element is empty? */
+        /* 't[limit]' is present; search for a boundary in [limit, asize) */
+        return newhint(t, binsearch(t, limit, asize));
       }
-      return boundary;
-    }
-  }
-  /* 'limit' is zero or present in table */
-  if (!limitequalsasize(t)) {  /* (2)? */
-    /* 'limit' > 0 and array has more elements after 'limit' */
-    if (arraykeyisempty(t, limit + 1))  /* 'limit + 1' is empty? */
-      return limit;  /* this is the boundary */
-    /* else, try last element in the array */
-    limit = luaH_realasize(t);
-    if (arraykeyisempty(t, limit)) {  /* empty? */
-      /* there must be a boundary in the array after old limit,
-         and it must be a valid new limit */
-      unsigned int boundary = binsearch(t, t->alimit, limit);
-      t->alimit = boundary;
-      return boundary;
     }
-    /* else, new limit is present in the table; check the hash part */
+    /* last element is present; keep it as the hint for the next call */
+    *lenhint(t) = asize;
   }
-  /* (3) 'limit' is the last element and either is zero or present in table */
-  lua_assert(limit == luaH_realasize(t) &&
-             (limit == 0 || !arraykeyisempty(t, limit)));
-  if (isdummy(t) || hashkeyisempty(t, limit + 1))
-    return limit;  /* 'limit + 1' is absent */
-  else  /* 'limit + 1' is also present */
-    return hash_search(t, limit);
+  /* no array part or 't[asize]' is present; check the hash part */
+  lua_assert(asize == 0 || !arraykeyisempty(t, asize));
+  if (isdummy(t) || hashkeyisempty(t, asize + 1))
+    return asize;  /* 'asize + 1' is absent */
+  else  /* 'asize + 1' is also present */
+    return hash_search(t, asize);
 }
 
 
@@ -48,7 +48,7 @@
 
 #define luaH_fastgeti(t,k,res,tag) \
   { Table *h = t; lua_Unsigned u = l_castS2U(k) - 1u; \
-    if ((u < h->alimit)) { \
+    if ((u < h->asize)) { \
       tag = *getArrTag(h, u); \
       if (!tagisempty(tag)) { farr2val(h, u, tag, res); }} \
     else { tag = luaH_getint(h, (k), res); }}
@@ -56,7 +56,7 @@
 
 #define luaH_fastseti(t,k,val,hres) \
   { Table *h = t; lua_Unsigned u = l_castS2U(k) - 1u; \
-    if ((u < h->alimit)) { \
+    if ((u < h->asize)) { \
       lu_byte *tag = getArrTag(h, u); \
       if (tagisempty(*tag)) hres = ~cast_int(u); \
       else { fval2arr(h, u, tag, val); hres = HOK; }} \
@@ -94,22 +94,27 @@
 /*
 ** The array part of a table is represented by an inverted array of
 ** values followed by an array of tags, to avoid wasting space with
-** padding.  The 'array' pointer points to the junction of the two
-** arrays, so that values are indexed with negative indices and tags
-** with non-negative indices.
+** padding. In between them there is an unsigned int, the length hint,
+** which keeps the last boundary found by the length operator.
+** The 'array' pointer points to the junction of the two arrays, so
+** that values are indexed with negative indices and tags with
+** non-negative indices.
 
-                     Values                      Tags
+                     Values                 Hint     Tags
         --------------------------------------------------------
-         ...  |   Value 1     |   Value 0     |0|1|...
+         ...  |   Value 1     |   Value 0     |hint|0|1|...
         --------------------------------------------------------
                                                ^ t->array
 
-** All accesses to 't->array' should be through the macros 'getArrTag'
-** and 'getArrVal'.
+** All accesses to 't->array' should be through the macros 'getArrTag',
+** 'getArrVal', and 'lenhint'.
 */
 
+/* Computes the address of the length hint of the array part */
+#define lenhint(t)	cast(unsigned*, (t)->array)
+
 /* Computes the address of the tag for the abstract C-index 'k' */
-#define getArrTag(t,k)	(cast(lu_byte*, (t)->array) + (k))
+#define getArrTag(t,k)	(cast(lu_byte*, (t)->array) + sizeof(unsigned) + (k))
 
 /* Computes the address of the value for the abstract C-index 'k' */
 #define getArrVal(t,k)	((t)->array - 1 - (k))
@@ -164,9 +169,19 @@ LUAI_FUNC void luaH_resize (lua_State *L, Table *t, unsigned nasize,
                                                     unsigned nhsize);
 LUAI_FUNC void luaH_resizearray (lua_State *L, Table *t, unsigned nasize);
 LUAI_FUNC void luaH_free (lua_State *L, Table *t);
+LUAI_FUNC size_t luaH_size (Table *t);
+LUAI_FUNC void luaH_clear (Table *t);
+LUAI_FUNC void luaH_copy (lua_State *L, Table *t, Table *src);
+LUAI_FUNC void luaH_fill (lua_State *L, Table *t, lua_Integer i,
+                                       lua_Integer e, TValue *v);
+LUAI_FUNC void luaH_reverse (lua_State *L, Table *t, lua_Integer i,
+                                                     lua_Integer e);
+LUAI_FUNC void luaH_move (lua_State *L, Table *src, lua_Integer f,
+                          lua_Integer n, Table *dst, lua_Integer d);
+LUAI_FUNC int luaH_find (Table *t, lua_Integer i, lua_Integer e,
+                         const TValue *v, lua_Integer *pos);
 LUAI_FUNC int luaH_next (lua_State *L, Table *t, StkId key);
 LUAI_FUNC lua_Unsigned luaH_getn (Table *t);
-LUAI_FUNC unsigned luaH_realasize (const Table *t);
 
 
 #if defined(LUA_DEBUG)
@@ -12,6 +12,7 @@
 
 #include <limits.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "lua.h"
@@ -19,6 +20,7 @@
 #include "lauxlib.h"
 #include "lualib.h"
 #include "llimits.h"
+#include "lapi.h"
 
 
 /*
@@ -69,6 +71,82 @@ static int tcreate (lua_State *L) {
 }
 
 
+static int tclear (lua_State *L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  lua_cleartable(L, 1);
+  return 0;
+}
+
+
+/*
+** {======================================================
+** Table pools
+** A pool keeps a list (upvalue 1 of its functions) of tables that
+** were released and can be reused, and a set (upvalue 2) with the same
+** tables, to detect double releases. Upvalues 3 and 4 of 'poolnew' are
+** the sizes for new tables.
+** =======================================================
+*/
+
+static int poolnew (lua_State *L) {
+  lua_Unsigned n = lua_rawlen(L, lua_upvalueindex(1));
+  if (n > 0) {  /* is there a released table? */
+    lua_rawgeti(L, lua_upvalueindex(1), l_castU2S(n));
+    lua_pushnil(L);
+    lua_rawseti(L, lua_upvalueindex(1), l_castU2S(n));  /* remove it */
+    lua_pushvalue(L, -1);
+    lua_pushnil(L);
+    lua_rawset(L, lua_upvalueindex(2));  /* ...also from the set */
+  }
+  else
+    lua_createtable(L, (unsigned)lua_tointeger(L, lua_upvalueindex(3)),
+                       (unsigned)lua_tointeger(L, lua_upvalueindex(4)));
+  return 1;
+}
+
+
+static int poolfree (lua_State *L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  lua_settop(L, 1);
+  lua_pushvalue(L, 1);
+  if (lua_rawget(L, lua_upvalueindex(2)) != LUA_TNIL)  /* in the pool? */
+    return luaL_error(L, "table already released");
+  if (luaL_getmetafield(L, 1, "__metatable") != LUA_TNIL)
+    return luaL_error(L, "cannot release a table with a protected metatable");
+  lua_settop(L, 1);
+  lua_cleartable(L, 1);  /* remove all its entries... */
+  lua_pushnil(L);
+  lua_setmetatable(L, 1);  /* ...and its metatable */
+  lua_pushvalue(L, 1);
+  lua_pushboolean(L, 1);
+  lua_rawset(L, lua_upvalueindex(2));  /* add it to the set... */
+  lua_rawseti(L, lua_upvalueindex(1),  /* ...and to the list */
+                 l_castU2S(lua_rawlen(L, lua_upvalueindex(1)) + 1));
+  return 0;
+}
+
+
+static int tpool (lua_State *L) {
+  lua_Unsigned sizeseq = (lua_Unsigned)luaL_checkinteger(L, 1);
+  lua_Unsigned sizerest = (lua_Unsigned)luaL_optinteger(L, 2, 0);
+  luaL_argcheck(L, sizeseq <= UINT_MAX, 1, "out of range");
+  luaL_argcheck(L, sizerest <= UINT_MAX, 2, "out of range");
+  lua_settop(L, 0);
+  lua_newtable(L);  /* list of released tables */
+  lua_newtable(L);  /* set of released tables */
+  lua_pushvalue(L, 1);
+  lua_pushvalue(L, 2);
+  lua_pushinteger(L, l_castU2S(sizeseq));
+  lua_pushinteger(L, l_castU2S(sizerest));
+  lua_pushcclosure(L, poolnew, 4);
+  lua_insert(L, 1);  /* put 'new' below list and set */
+  lua_pushcclosure(L, poolfree, 2);
+  return 2;  /* return 'new' and 'free' functions */
+}
+
+/* }====================================================== */
+
+
 static int tinsert (lua_State *L) {
   lua_Integer pos;  /* where to insert new element */
   lua_Integer e = aux_getn(L, 1, TAB_RW);
@@ -155,6 +233,162 @@ static int tmove (lua_State *L) {
 }
 
 
+/*
+** {======================================================
+** Bulk operations
+** =======================================================
+*/
+
+/*
+** Tables without metatables can use the raw bulk operations from
+** 'lapi.h'; other objects go through the generic (metamethod) path.
+*/
+static int israwtable (lua_State *L, int arg) {
+  if (lua_type(L, arg) != LUA_TTABLE)
+    return 0;
+  else if (lua_getmetatable(L, arg)) {  /* table has a metatable? */
+    lua_pop(L, 1);
+    return 0;
+  }
+  else
+    return 1;
+}
+
+
+/*
+** Get the end of an interval: argument 'arg' if present, otherwise
+** the length of the list. (Length is computed only when needed.)
+*/
+static lua_Integer getend (lua_State *L, int arg, int what) {
+  if (lua_isnoneornil(L, arg))
+    return aux_getn(L, 1, what);
+  else {
+    checktab(L, 1, what);
+    return luaL_checkinteger(L, arg);
+  }
+}
+
+
+/*
+** Assign 'value' to list[i], ..., list[j].
+*/
+static int tfill (lua_State *L) {
+  lua_Integer e = getend(L, 4, TAB_W);
+  lua_Integer i = luaL_optinteger(L, 3, 1);
+  luaL_checkany(L, 2);
+  lua_settop(L, 2);
+  if (israwtable(L, 1))
+    luaA_rawfill(L, 1, i, e);
+  else if (i <= e) {  /* non-empty interval? */
+    for (; i < e; i++) {  /* assign list[i..e - 1] (to avoid overflows) */
+      lua_pushvalue(L, 2);
+      lua_seti(L, 1, i);
+    }
+    lua_seti(L, 1, e);  /* assign last element */
+  }
+  lua_settop(L, 1);
+  return 1;  /* return list */
+}
+
+
+/*
+** Reverse, in place, the elements list[i], ..., list[j].
+*/
+static int treverse (lua_State *L) {
+  lua_Integer e = getend(L, 3, TAB_RW);
+  lua_Integer i = luaL_optinteger(L, 2, 1);
+  lua_settop(L, 1);
+  if (israwtable(L, 1))
+    luaA_rawreverse(L, 1, i, e);
+  else {
+    for (; i < e; i++, e--) {
+      lua_geti(L, 1, i);
+      lua_geti(L, 1, e);
+      lua_seti(L, 1, i);  /* list[i] = list[e] */
+      lua_seti(L, 1, e);  /* list[e] = old list[i] */
+    }
+  }
+  return 1;  /* return list */
+}
+
+
+/*
+** Return a new sequence with the elements list[i], ..., list[j].
+*/
+static int tslice (lua_State *L) {
+  lua_Integer e = getend(L, 3, TAB_R);
+  lua_Integer i = luaL_optinteger(L, 2, 1);
+  lua_Unsigned n, k;
+  if (i > e)  /* empty interval? */
+    n = 0;
+  else {
+    n = l_castS2U(e) - l_castS2U(i);  /* number of elements minus 1 */
+    luaL_argcheck(L, n < (unsigned int)INT_MAX, 3, "too many elements");
+    n++;
+  }
+  lua_settop(L, 1);
+  lua_createtable(L, (unsigned)n, 0);
+  if (israwtable(L, 1))
+    luaA_rawmove(L, 1, i, e, 2, 1);
+  else {
+    for (k = 0; k < n; k++) {
+      lua_geti(L, 1, l_castU2S(l_castS2U(i) + k));
+      lua_rawseti(L, 2, l_castU2S(k + 1));
+    }
+  }
+  return 1;
+}
+
+
+/*
+** Return a shallow copy of a table (ignoring its metatable).
+*/
+static int tcopy (lua_State *L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  luaA_clonetable(L, 1);
+  return 1;
+}
+
+
+/*
+** Return the first index 'k' in i, ..., #list such that
+** list[k] == value, or fail if there is no such index.
+*/
+static int tfind (lua_State *L) {
+  lua_Integer e = aux_getn(L, 1, TAB_R);
+  lua_Integer i = luaL_optinteger(L, 3, 1);
+  int tv;
+  luaL_checkany(L, 2);
+  tv = lua_type(L, 2);
+  lua_settop(L, 2);
+  /* raw search is enough unless an '__eq' metamethod may apply */
+  if (tv != LUA_TTABLE && tv != LUA_TUSERDATA && israwtable(L, 1)) {
+    lua_Integer pos;
+    lua_pushvalue(L, 2);
+    if (luaA_rawfind(L, 1, i, e, &pos)) {
+      lua_pushinteger(L, pos);
+      return 1;
+    }
+  }
+  else {
+    for (; i <= e; i++) {
+      lua_geti(L, 1, i);
+      if (lua_compare(L, -1, 2, LUA_OPEQ)) {
+        lua_pushinteger(L, i);
+        return 1;
+      }
+      lua_pop(L, 1);
+      if (i == e)  /* last element? */
+        break;  /* avoid overflows in 'i++' */
+    }
+  }
+  luaL_pushfail(L);
+  return 1;
+}
+
+/* }====================================================== */
+
+
 static void addfield (lua_State *L, luaL_Buffer *b, lua_Integer i) {
   lua_geti(L, 1, i);
   if (l_unlikely(!lua_isstring(L, -1)))
@@ -391,6 +625,195 @@ static void auxsort (lua_State *L, IdxT lo, IdxT up, unsigned rnd) {
 }
 
 
+/*
+** {======================================================
+** Raw sort: when there is no order function, the array is a plain
+** table (no metatable), and its elements are all integers, all floats,
+** or all strings, the default order does not need the API. Then,
+** 'sort' copies the elements into a C array, sorts it with 'qsort',
+** and stores the result back into the table.
+** =======================================================
+*/
+
+/* arrays smaller than 'l_rawsortlimit' always use the generic sort */
+#if !defined(l_rawsortlimit)
+#define l_rawsortlimit	100u
+#endif
+
+
+typedef struct RawStr {
+  const char *s;  /* contents of the string */
+  size_t l;  /* its length */
+  IdxT pos;  /* its original position in the array */
+} RawStr;
+
+
+static int cmpint (const void *a, const void *b) {
+  lua_Integer x = *(const lua_Integer *)a;
+  lua_Integer y = *(const lua_Integer *)b;
+  return (y < x) - (x < y);
+}
+
+
+static int cmpflt (const void *a, const void *b) {
+  lua_Number x = *(const lua_Number *)a;
+  lua_Number y = *(const lua_Number *)b;
+  return (y < x) - (x < y);
+}
+
+
+/*
+** Compare two strings as 'l_strcmp' in the core does: 'strcoll'
+** compares segments up to a '\0'; the segments are handled one by one.
+*/
+static int cmpstr (const void *a, const void *b) {
+  const char *s1 = ((const RawStr *)a)->s;
+  size_t rl1 = ((const RawStr *)a)->l;
+  const char *s2 = ((const RawStr *)b)->s;
+  size_t rl2 = ((const RawStr *)b)->l;
+  for (;;) {  /* for each segment */
+    int temp = strcoll(s1, s2);
+    if (temp != 0)  /* not equal? */
+      return temp;  /* done */
+    else {  /* strings are equal up to a '\0' */
+      size_t zl1 = strlen(s1);  /* index of first '\0' in 's1' */
+      size_t zl2 = strlen(s2);  /* index of first '\0' in 's2' */
+      if (zl2 == rl2)  /* 's2' is finished? */
+        return (zl1 == rl1) ? 0 : 1;  /* check 's1' */
+      else if (zl1 == rl1)  /* 's1' is finished? */
+        return -1;  /* 's1' is less than 's2' ('s2' is not finished) */
+      /* both strings longer than 'zl'; go on comparing after the '\0' */
+      zl1++; zl2++;
+      s1 += zl1; rl1 -= zl1; s2 += zl2; rl2 -= zl2;
+    }
+  }
+}
+
+
+/*
+** Push a new userdata to work as a C array with 'n' elements of size
+** 'sz'. Returns NULL (pushing nothing) if that size would overflow.
+*/
+static void *newarray (lua_State *L, IdxT n, size_t sz) {
+  if (n > MAX_SIZET / sz)
+    return NULL;
+  return lua_newuserdatauv(L, n * sz, 0);
+}
+
+
+/*
+** Sort an array of numbers that are all integers ('isint') or all
+** non-NaN floats. Returns 0 (leaving the table untouched) if some
+** element does not fit.
+*/
+static int rawsortnum (lua_State *L, IdxT n, int isint) {
+  size_t sz = isint ? sizeof(lua_Integer) : sizeof(lua_Number);
+  void *a = newarray(L, n, sz);
+  IdxT i;
+  if (a == NULL)
+    return 0;
+  for (i = 0; i < n; i++) {
+    lua_rawgeti(L, 1, l_castU2S(i + 1));
+    if (isint) {
+      if (!lua_isinteger(L, -1))
+        break;
+      ((lua_Integer *)a)[i] = lua_tointeger(L, -1);
+    }
+    else {
+      if (lua_type(L, -1) != LUA_TNUMBER || lua_isinteger(L, -1) ||
+          luai_numisnan(lua_tonumber(L, -1)))
+        break;
+      ((lua_Number *)a)[i] = lua_tonumber(L, -1);
+    }
+    lua_pop(L, 1);
+  }
+  if (i < n) {  /* found an element that does not fit? */
+    lua_pop(L, 2);  /* remove element and array */
+    return 0;
+  }
+  qsort(a, n, sz, isint ? cmpint : cmpflt);
+  for (i = 0; i < n; i++) {
+    if (isint)
+      lua_pushinteger(L, ((lua_Integer *)a)[i]);
+    else
+      lua_pushnumber(L, ((lua_Number *)a)[i]);
+    lua_rawseti(L, 1, l_castU2S(i + 1));
+  }
+  lua_pop(L, 1);  /* remove array */
+  return 1;
+}
+
+
+/*
+** Sort an array of strings. The C array keeps pointers to the
+** contents of the strings, which stay anchored by the table. So, the
+** result is stored back by following the cycles of the permutation,
+** so that each string is always in the table or on the stack.
+*/
+static int rawsortstr (lua_State *L, IdxT n) {
+  RawStr *a;
+  IdxT i;
+  a = (RawStr *)newarray(L, n, sizeof(RawStr));
+  if (a == NULL)
+    return 0;
+  for (i = 0; i < n; i++) {
+    if (lua_rawgeti(L, 1, l_castU2S(i + 1)) != LUA_TSTRING) {
+      lua_pop(L, 2);  /* remove element and array */
+      return 0;
+    }
+    a[i].s = lua_tolstring(L, -1, &a[i].l);
+    a[i].pos = i + 1;
+    lua_pop(L, 1);
+  }
+  qsort(a, n, sizeof(RawStr), cmpstr);
+  for (i = 0; i < n; i++) {
+    IdxT j = i;  /* current position in the cycle */
+    if (a[i].pos == i + 1)  /* already in place? */
+      continue;
+    lua_rawgeti(L, 1, l_castU2S(i + 1));  /* keep first element of cycle */
+    for (;;) {
+      IdxT src = a[j].pos;  /* element that must go to position 'j + 1' */
+      a[j].pos = j + 1;  /* mark position as done */
+      if (src == i + 1) {  /* end of the cycle? */
+        lua_rawseti(L, 1, l_castU2S(j + 1));  /* use saved element */
+        break;
+      }
+      lua_rawgeti(L, 1, l_castU2S(src));
+      lua_rawseti(L, 1, l_castU2S(j + 1));
+      j = src - 1;
+    }
+  }
+  lua_pop(L, 1);  /* remove array */
+  return 1;
+}
+
+
+/*
+** Try to sort the array without going through the API for each
+** comparison. Returns 0 if the array is not suitable for that.
+*/
+static int rawsort (lua_State *L, IdxT n) {
+  int tp;
+  if (n < l_rawsortlimit || !lua_isnil(L, 2) ||
+      lua_type(L, 1) != LUA_TTABLE)
+    return 0;
+  if (lua_getmetatable(L, 1)) {  /* table has a metatable? */
+    lua_pop(L, 1);
+    return 0;  /* its elements may have metamethods */
+  }
+  tp = lua_rawgeti(L, 1, 1);
+  if (tp == LUA_TNUMBER) {
+    int isint = lua_isinteger(L, -1);
+    lua_pop(L, 1);
+    return rawsortnum(L, n, isint);
+  }
+  lua_pop(L, 1);
+  return (tp == LUA_TSTRING) ? rawsortstr(L, n) : 0;
+}
+
+/* }====================================================== */
+
+
 static int sort (lua_State *L) {
   lua_Integer n = aux_getn(L, 1, TAB_RW);
   if (n > 1) {  /* non-trivial interval? */
@@ -398,7 +821,8 @@ static int sort (lua_State *L) {
     if (!lua_isnoneornil(L, 2))  /* is there a 2nd argument? */
       luaL_checktype(L, 2, LUA_TFUNCTION);  /* must be a function */
     lua_settop(L, 2);  /* make sure there are two arguments */
-    auxsort(L, 1, (IdxT)n, 0);
+    if (!rawsort(L, (IdxT)n))
+      auxsort(L, 1, (IdxT)n, 0);
   }
   return 0;
 }
@@ -407,13 +831,20 @@ static int sort (lua_State *L) {
 
 
 static const luaL_Reg tab_funcs[] = {
+  {"clear", tclear},
   {"concat", tconcat},
+  {"copy", tcopy},
   {"create", tcreate},
+  {"fill", tfill},
+  {"find", tfind},
   {"insert", tinsert},
   {"pack", tpack},
   {"unpack", tunpack},
   {"remove", tremove},
   {"move", tmove},
+  {"pool", tpool},
+  {"reverse", treverse},
+  {"slice", tslice},
   {"sort", sort},
   {NULL, NULL}
 };
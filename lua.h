@@ -285,6 +285,7 @@ LUA_API void  (lua_rawseti) (lua_State *L, int idx, lua_Integer n);
 LUA_API void  (lua_rawsetp) (lua_State *L, int idx, const void *p);
 LUA_API int   (lua_setmetatable) (lua_State *L, int objindex);
 LUA_API int   (lua_setiuservalue) (lua_State *L, int idx, int n);
+LUA_API void  (lua_cleartable) (lua_State *L, int idx);
 
 
 /*
@@ -303,6 +304,8 @@ LUA_API int   (lua_load) (lua_State *L, lua_Reader reader, void *dt,
 
 LUA_API int (lua_dump) (lua_State *L, lua_Writer writer, void *data, int strip);
 
+LUA_API int (lua_heapdump) (lua_State *L, lua_Writer writer, void *data);
+
 
 /*
 ** coroutine functions
@@ -338,6 +341,10 @@ LUA_API void (lua_warning)  (lua_State *L, const char *msg, int tocont);
 #define LUA_GCGEN		7
 #define LUA_GCINC		8
 #define LUA_GCPARAM		9
+#define LUA_GCLIMIT		10
+#define LUA_GCPEAK		11
+#define LUA_GCDEFERFIN		12
+#define LUA_GCRUNFIN		13
 
 
 /*
@@ -357,7 +364,22 @@ LUA_API void (lua_warning)  (lua_State *L, const char *msg, int tocont);
 #define LUA_GCPN		6
 
 
+/*
+** garbage-collection statistics
+*/
+#define LUA_GCSMINOR		0  /* number of minor collections */
+#define LUA_GCSMAJOR		1  /* number of major (complete) cycles */
+#define LUA_GCSMARKED		2  /* number of objects marked */
+#define LUA_GCSFREED		3  /* number of objects freed */
+#define LUA_GCSFREEDBYTES	4  /* bytes freed by the collector */
+#define LUA_GCSFINALIZED	5  /* number of finalizers called */
+
+/* number of statistics */
+#define LUA_GCSN		6
+
+
 LUA_API int (lua_gc) (lua_State *L, int what, ...);
+LUA_API lua_Integer (lua_gcstat) (lua_State *L, int stat, int reset);
 
 
 /*
@@ -689,6 +689,20 @@
 #endif
 
 
+/*
+@@ luai_gcclock gives the current time, in microseconds (as a float),
+** used to measure the budget of 'collectgarbage("budget")', or a
+** negative value if there is no clock. The default uses 'clock', which
+** measures processor time for the whole process (including other
+** threads) and can wrap around; a host can define it to use a
+** monotonic wall clock instead. (Code using this macro must include
+** the header 'time.h'.)
+*/
+#if !defined(luai_gcclock)
+#define luai_gcclock()	((double)clock() / CLOCKS_PER_SEC * 1e6)
+#endif
+
+
 /*
 ** macros to improve jump prediction, used mostly for error handling
 ** and debug facilities. (Some macros in the Lua API use these macros.
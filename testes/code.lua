@@ -301,6 +301,22 @@ checkI(function () return 0xF0.0 | 0xCC.0 ~ 0xAA & 0xFD end, 0xF4)
 checkI(function () return ~(~kFF0 | kFF0) end, 0)
 checkI(function () return ~~-1024.0 end, -1024)
 checkI(function () return ((100 << k6) << -4) >> 2 end, 100)
+checkI(function () return #kx + #"abc" end, 4)
+checkK(function () return "a" .. kx .. ("b" .. "c") end, "axbc")
+checkK(function () return "a\0" .. "" .. "b" end, "a\0b")
+
+-- folding of comparisons
+check(function () return 1 < 2, 2.5 >= k3, kx == "x", 1 == 1.0, "1" ~= 1 end,
+  'LOADTRUE', 'LOADFALSE', 'LOADTRUE', 'LOADTRUE', 'LOADTRUE', 'RETURN',
+  'RETURN0')
+check(function (x) if k1 > 2 then x() elseif #kx == 1 then x = 1 end end,
+  'JMP', 'MOVE', 'CALL', 'RETURN0', 'LOADI', 'RETURN0')
+
+-- concatenation with string constants
+checkR(function (x) return "a" .. "b" .. x .. "c" .. "d" end, "x", "abxcd",
+  'MOVE', 'LOADK', 'LOADK', 'LOADK', 'CONCAT', 'RETURN1')
+checkR(function (x) return "a" .. (x or "b") .. "c" end, nil, "abc",
+  'TESTSET', 'JMP', 'LOADK', 'LOADK', 'LOADK', 'CONCAT', 'RETURN1')
 
 -- borders around MAXARG_sBx ((((1 << 17) - 1) >> 1) == 65535)
 local a = 17; local sbx = ((1 << a) - 1) >> 1   -- avoid folding
@@ -420,6 +436,19 @@ check(function (a, b)
       end,
 'TEST', 'JMP', 'TEST', 'JMP', 'ADDI', 'MMBINI', 'JMP', 'RETURN0')
 
+-- jumps to returns
+check(function (a)
+        if a then a = 1 else a = 2 end
+      end,
+'TEST', 'JMP', 'LOADI', 'RETURN0', 'LOADI', 'RETURN0')
+
+check(function (a)
+        local x
+        if a then x = 10 else x = 20 end
+        return x
+      end,
+'LOADNIL', 'TEST', 'JMP', 'LOADI', 'RETURN1', 'LOADI', 'RETURN1')
+
 checkequal(function () return 6 or true or nil end,
            function () return k6 or kTrue or kNil end)
 
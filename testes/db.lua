@@ -130,6 +130,16 @@ else
 end
 ]], {2,3,4,7})
 
+test([[local function f (a)
+  if a then
+    a = 1
+  else
+    a = 2
+  end
+end
+f(true); f(false)
+]], {7,8,2,3,7,2,5,7})
+
 
 test([[
 local function foo()
@@ -1050,5 +1060,58 @@ do   -- tests for 'source' in binary dumps
          debug.getinfo(h).source == '=?')
 end
 
+
+do  print("testing heap dump")
+  local fname = os.tmpname()
+  local s = string.rep("x", 100) .. "unique"
+  local t = {s}
+  assert(debug.heapdump(fname))
+  local f = assert(io.open(fname))
+  local roots = string.match(f:read("l"), "^roots (.*)$")
+  local objs = {}
+  for l in f:lines() do
+    local a, tp, sz, refs = string.match(l, "^(%S+) (%a+) (%d+)(.*)$")
+    assert(a and tonumber(sz) > 0 and not objs[a])
+    objs[a] = {tp = tp, refs = refs}
+  end
+  f:close()
+  assert(os.remove(fname))
+  local ot, ostr = objs[string.format("%p", t)], objs[string.format("%p", s)]
+  assert(ot.tp == "table" and ostr.tp == "string")
+  assert(string.find(ot.refs, string.format("%p", s), 1, true))
+  -- all references go to dumped objects
+  for r in string.gmatch(roots, "%S+") do assert(objs[r]) end
+  for _, o in pairs(objs) do
+    for r in string.gmatch(o.refs, "%S+") do assert(objs[r]) end
+  end
+  local st, msg = debug.heapdump("/non-existent-dir/file")
+  assert(not st and string.find(msg, "non%-existent%-dir"))
+end
+
+
+do  print("testing retained sizes from a heap dump")
+  local heapstat = require"heapstat"
+  local fname = os.tmpname()
+  local shared = string.rep("s", 1000) .. "shared"
+  local a = {string.rep("a", 5000) .. "only a", shared}
+  local b = {{string.rep("b", 3000) .. "only b"}, shared}
+  assert(debug.heapdump(fname))
+  local roots, objs = heapstat.read(fname)
+  local root = heapstat.dominators(roots, objs)
+  local function obj (x) return objs[string.format("%p", x)] end
+  local oa, ob = obj(a), obj(b)
+  -- each table retains itself and what only it refers to
+  assert(oa.retained == oa.size + obj(a[1]).size)
+  assert(ob.retained == ob.size + obj(b[1]).retained)
+  assert(obj(b[1]).retained == obj(b[1]).size + obj(b[1][1]).size)
+  -- an object referred by both is retained by neither
+  assert(obj(shared).idom ~= oa and obj(shared).idom ~= ob)
+  assert(root.retained >= oa.retained + ob.retained + obj(shared).size)
+  local list, total = heapstat.top(fname, 5)
+  assert(#list == 5 and total == root.retained)
+  for i = 2, #list do assert(list[i - 1].retained >= list[i].retained) end
+  assert(os.remove(fname))
+end
+
 print"OK"
 
@@ -75,6 +75,135 @@ do  print("steps")
 end
 
 
+do  print("time-budgeted steps")
+  local oldmode = collectgarbage("incremental")
+  collectgarbage()
+  local a = {}
+  for i = 1, 1000 do a[i] = {{}} end
+  a = nil
+  local res, used = collectgarbage("budget", 10^9)   -- enough to finish
+  assert(res and math.type(used) == "integer" and used >= 0)
+  local res, used = collectgarbage("budget", 0)   -- one basic step
+  assert(used >= 0)
+  repeat until collectgarbage("budget", 100)
+  local st, msg = pcall(collectgarbage, "budget", -1)
+  assert(not st and string.find(msg, "negative budget"))
+  collectgarbage(oldmode)
+end
+
+
+do  print("large strings pace the collector")
+  for _, mode in ipairs{"incremental", "generational"} do
+    local oldmode = collectgarbage(mode)
+    collectgarbage()
+    local base = collectgarbage("count")
+    local big = string.rep("x", 100000)
+    local max = 0
+    for i = 1, 1000 do   -- create 100 MB of garbage
+      local s = big .. i
+      max = math.max(max, collectgarbage("count"))
+    end
+    assert(max - base < 10 * 1024)   -- less than 10 MB in use
+    collectgarbage(oldmode)
+  end
+end
+
+
+do  print("memory limit")
+  if T then warn("@store") end
+  collectgarbage()
+  local limit = math.floor(collectgarbage("count")) + 2048   -- 2 MB more
+  assert(collectgarbage("limit", limit) == 0)
+  assert(collectgarbage("limit") == limit)
+  local big = string.rep("x", 100000)
+  for i = 1, 1000 do   -- garbage does not reach the limit
+    local s = big .. i
+  end
+  local t = {}
+  local st, msg = pcall(function ()   -- live data does
+    for i = 1, math.huge do t[i] = big .. i end
+  end)
+  assert(not st and msg == "not enough memory" and #t < 25)
+  t = nil
+  assert(collectgarbage("limit", 0) == limit)
+  assert(collectgarbage("peak") <= limit)
+  assert(collectgarbage("peak") <= collectgarbage("count") + 1)
+  if T then
+    assert(string.find(_WARN, "memory in use near its limit")); _WARN = false
+    warn("@normal")
+  end
+end
+
+
+if T then  print("blocks can shrink while over the limit")
+  collectgarbage()
+  local t = {}
+  for i = 1, 10000 do t[i] = "str" .. i end
+  local size = T.querystr()
+  t = nil
+  collectgarbage("deferfinalizers", true)   -- they could not allocate
+  collectgarbage("limit", 1)   -- everything is over this limit
+  collectgarbage()   -- shrinks the string table in place
+  collectgarbage("limit", 0)
+  collectgarbage("deferfinalizers", false)
+  assert(T.querystr() < size)
+end
+
+
+
+do  print("collector statistics")
+  local oldmode = collectgarbage("generational")
+  collectgarbage("stats", true)   -- reset counters
+  local st = collectgarbage("stats")
+  assert(st.minor == 0 and st.major == 0 and st.freed == 0)
+  local t = {}
+  for i = 1, 1000 do t[i] = {} end
+  local fin
+  setmetatable({}, {__gc = function ()
+    fin = collectgarbage("stats")   -- also accessible in finalizers
+  end})
+  t = nil
+  collectgarbage("step")   -- a minor collection
+  collectgarbage()   -- a major one
+  st = collectgarbage("stats")
+  assert(st.minor >= 1 and st.major >= 1 and type(fin) == "table")
+  assert(st.freed >= 1000 and st.marked > 0 and st.freedbytes > 0)
+  assert(math.type(st.freedbytes) == "integer")
+  assert(st.finalized >= 1)
+  collectgarbage("incremental")
+  collectgarbage("stats", true)
+  collectgarbage(); collectgarbage()
+  st = collectgarbage("stats")
+  assert(st.minor == 0 and st.major == 2 and st.freed > 0)
+  collectgarbage(oldmode)
+end
+
+
+do  print("deferred finalizers")
+  for _, mode in ipairs{"incremental", "generational"} do
+    local oldmode = collectgarbage(mode)
+    collectgarbage()
+    assert(collectgarbage("runfinalizers") == 0)   -- nothing pending
+    assert(not collectgarbage("deferfinalizers", true))
+    assert(collectgarbage("deferfinalizers"))
+    local count = 0
+    for i = 1, 10 do
+      setmetatable({}, {__gc = function () count = count + 1 end})
+    end
+    collectgarbage(); collectgarbage()
+    assert(count == 0)   -- collected, but not finalized
+    assert(collectgarbage("runfinalizers", 3) == 3 and count == 3)
+    assert(collectgarbage("runfinalizers", 1) == 1 and count == 4)
+    assert(collectgarbage("runfinalizers") >= 6 and count == 10)
+    assert(collectgarbage("deferfinalizers", false))
+    setmetatable({}, {__gc = function () count = count + 1 end})
+    collectgarbage()
+    assert(count == 11)   -- finalizer runs with the collection
+    collectgarbage(oldmode)
+  end
+end
+
+
 _G["while"] = 234
 
 
@@ -0,0 +1,137 @@
+-- analysis of heap dumps (see 'debug.heapdump')
+--
+-- As a script:  lua heapstat.lua dumpfile [n]
+-- lists the 'n' (default 20) objects that retain most memory.
+--
+-- The retained size of an object is the total size of the objects
+-- that would be collected if that object were collected, that is,
+-- of the objects it dominates in the reference graph, starting from
+-- the roots. (Weak references count as ordinary references, so
+-- retained sizes can only be smaller than the real ones.)
+
+local M = {}
+
+
+-- read a dump; returns a list of the roots and a table mapping each
+-- address to an object {tp = type, size = size, refs = list of addresses}
+function M.read (fname)
+  local f = assert(io.open(fname))
+  local line = f:read("l")
+  local rs = line and string.match(line, "^roots(.*)$")
+  if not rs then error("'" .. fname .. "' is not a heap dump") end
+  local roots = {}
+  for r in string.gmatch(rs, "%S+") do roots[#roots + 1] = r end
+  local objs = {}
+  for l in f:lines() do
+    local a, tp, sz, refs = string.match(l, "^(%S+) (%a+) (%d+)(.*)$")
+    if not a then error("invalid line in heap dump: " .. l) end
+    local o = {tp = tp, size = tonumber(sz), refs = {}}
+    for r in string.gmatch(refs, "%S+") do o.refs[#o.refs + 1] = r end
+    objs[a] = o
+  end
+  f:close()
+  return roots, objs
+end
+
+
+-- computes the immediate dominator ('idom') and the retained size
+-- ('retained') of each object reachable from the roots, using the
+-- iterative algorithm by Cooper, Harvey, and Kennedy. (Objects not
+-- reachable from the roots, which are garbage, get no fields.)
+function M.dominators (roots, objs)
+  local root = {tp = "<roots>", size = 0, refs = roots}
+  -- depth-first search, numbering nodes in postorder
+  local order = {}   -- nodes in postorder
+  local preds = {}   -- predecessors of each node
+  local visited = {[root] = true}
+  local stack = {{node = root, i = 0}}
+  while #stack > 0 do
+    local top = stack[#stack]
+    local node = top.node
+    top.i = top.i + 1
+    local a = node.refs[top.i]
+    if a == nil then   -- all successors visited
+      stack[#stack] = nil
+      order[#order + 1] = node
+      node.post = #order
+    else
+      local succ = objs[a]
+      if succ then   -- (weak references may go to dead objects)
+        local p = preds[succ]
+        if not p then p = {}; preds[succ] = p end
+        p[#p + 1] = node
+        if not visited[succ] then
+          visited[succ] = true
+          stack[#stack + 1] = {node = succ, i = 0}
+        end
+      end
+    end
+  end
+  local function intersect (a, b)
+    while a ~= b do
+      while a.post < b.post do a = a.idom end
+      while b.post < a.post do b = b.idom end
+    end
+    return a
+  end
+  root.idom = root
+  local changed = true
+  while changed do
+    changed = false
+    for i = #order - 1, 1, -1 do   -- reverse postorder, skipping root
+      local node = order[i]
+      local new
+      for _, p in ipairs(preds[node]) do
+        if p.idom then   -- already processed?
+          new = new and intersect(p, new) or p
+        end
+      end
+      if node.idom ~= new then
+        node.idom = new
+        changed = true
+      end
+    end
+  end
+  -- a node comes before its dominators in postorder
+  for i = 1, #order do
+    local node = order[i]
+    node.retained = (node.retained or 0) + node.size
+    if node ~= root then
+      node.idom.retained = (node.idom.retained or 0) + node.retained
+    end
+  end
+  root.idom = nil
+  return root
+end
+
+
+-- returns a list with the 'n' objects with the largest retained sizes,
+-- each with field 'addr', and the total size reachable from the roots
+function M.top (fname, n)
+  local roots, objs = M.read(fname)
+  local root = M.dominators(roots, objs)
+  local list = {}
+  for a, o in pairs(objs) do
+    if o.retained then
+      o.addr = a
+      list[#list + 1] = o
+    end
+  end
+  table.sort(list, function (a, b) return a.retained > b.retained end)
+  for i = #list, n + 1, -1 do list[i] = nil end
+  return list, root.retained
+end
+
+
+if arg and arg[0] and string.find(arg[0], "heapstat%.lua$") then
+  local fname = arg[1] or error("usage: lua heapstat.lua dumpfile [n]")
+  local list, total = M.top(fname, tonumber(arg[2]) or 20)
+  io.write(string.format("%d bytes reachable from the roots\n", total))
+  io.write("  retained      size  type      address\n")
+  for _, o in ipairs(list) do
+    io.write(string.format("%10d%10d  %-9s %s\n",
+                           o.retained, o.size, o.tp, o.addr))
+  end
+end
+
+return M
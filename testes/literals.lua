@@ -227,7 +227,8 @@ do  -- reuse of long strings
   assert(a1 == getadd(foo1()))
   assert(a1 == getadd(foo2()))
 
-  local sd = "0123456789" .. "0123456789012345678901234567890123456789"
+  local p = "0123456789"   -- not a constant; concatenation not folded
+  local sd = p .. "0123456789012345678901234567890123456789"
   assert(sd == s1 and getadd(sd) ~= a1)
 end
 
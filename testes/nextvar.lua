@@ -202,19 +202,23 @@ local a = {}
 for i=1,lim do a[i] = true; foo(i, table.unpack(a)) end
 
 
--- Table length with limit smaller than maximum value at array
+-- Table length with hint smaller than maximum value at array
 local a = {}
 for i = 1,64 do a[i] = true end    -- make its array size 64
+assert(#a == 64)               -- this sets the hint to 64
 for i = 1,64 do a[i] = nil end     -- erase all elements
 assert(T.querytab(a) == 64)    -- array part has 64 elements
-a[32] = true; a[48] = true;    -- binary search will find these ones
+a[30] = true; a[45] = true;    -- binary search will find these ones
 a[51] = true                   -- binary search will miss this one
-assert(#a == 48)               -- this will set the limit
-assert(select(3, T.querytab(a)) == 48)  -- this is the limit now
-a[50] = true                   -- this will set a new limit
-assert(select(3, T.querytab(a)) == 50)  -- this is the limit now
--- but the size is larger (and still inside the array part)
-assert(#a == 51)
+assert(#a == 45)               -- this will set the hint
+assert(select(3, T.querytab(a)) == 45)  -- this is the hint now
+a[46] = true; a[47] = true     -- boundary is in the vicinity of the hint
+assert(#a == 47)
+assert(select(3, T.querytab(a)) == 47)  -- this is the hint now
+a[47] = nil; a[46] = nil
+assert(#a == 45 and select(3, T.querytab(a)) == 45)
+for i = 1, 64 do a[i] = i end  -- last element is present
+assert(#a == 64 and select(3, T.querytab(a)) == 64)
 
 end  --]
 
@@ -40,6 +40,56 @@ do print "testing 'table.create'"
 end
 
 
+do print "testing 'table.clear' and 'table.pool'"
+  local N = 1000
+  local t = table.create(N, 64)
+  for i = 1, N do t[i] = i end
+  for i = 1, 64 do t["k" .. i] = i end
+  collectgarbage()
+  local m = collectgarbage("count")
+  assert(table.clear(t) == nil)
+  assert(next(t) == nil and #t == 0)
+  assert(collectgarbage("count") == m)   -- memory is kept
+  assert(not T or T.querytab(t) == N and select(2, T.querytab(t)) == 64)
+  for i = 1, N do t[i] = -i end   -- reuse the table
+  for i = 1, 64 do t["x" .. i] = i end
+  assert(#t == N and t[N] == -N and t.x64 == 64 and t.k1 == nil)
+  assert(not T or T.querytab(t) == N and select(2, T.querytab(t)) == 64)
+  local mt = {}
+  t = setmetatable({1, 2, x = 3}, mt)
+  table.clear(t)
+  assert(next(t) == nil and getmetatable(t) == mt)
+  checkerror("table expected", table.clear, 10)
+
+  local new, free = table.pool(10, 4)
+  local t1, t2 = new(), new()
+  assert(type(t1) == "table" and t1 ~= t2 and next(t1) == nil)
+  assert(not T or T.querytab(t1) == 10 and select(2, T.querytab(t1)) == 4)
+  t1[1] = 10; t1.x = 20; setmetatable(t1, mt)
+  free(t1)
+  assert(next(t1) == nil and getmetatable(t1) == nil)
+  free(t2)
+  assert(new() == t2 and new() == t1)   -- reuse released tables
+  local t3 = new()
+  assert(t3 ~= t1 and t3 ~= t2)
+  checkerror("table expected", free, 10)
+  checkerror("out of range", table.pool, -1)
+
+  -- double release is an error
+  free(t3)
+  checkerror("already released", free, t3)
+  assert(new() == t3 and new() ~= t3)
+  free(t3)   -- can release it again after reuse
+  assert(new() == t3)
+
+  -- protected metatables are kept
+  local t4 = setmetatable({10}, {__metatable = "locked"})
+  checkerror("protected metatable", free, t4)
+  assert(getmetatable(t4) == "locked" and t4[1] == 10)
+  assert(new() ~= t4)
+end
+
+
 print "testing unpack"
 
 local unpack = table.unpack
@@ -207,6 +257,119 @@ do
   checkmove(minI + 1, -1, 1, minI + 1, 1)  -- non overlapping
 end
 
+
+print "testing fill, reverse, slice, copy, and find"
+do
+  local function eqT (a, b)
+    for k, v in pairs(a) do assert(b[k] == v) end
+    for k, v in pairs(b) do assert(a[k] == v) end
+  end
+
+  local a = {1, 2, 3, 4, 5}
+  assert(table.fill(a, 0, 2, 4) == a)
+  eqT(a, {1, 0, 0, 0, 5})
+  eqT(table.fill({1, 2, 3}, "x"), {"x", "x", "x"})
+  eqT(table.fill({1, 2, 3}, nil, 2), {1})
+  eqT(table.fill({}, true, 1, 3), {true, true, true})
+  eqT(table.fill({}, 1, 3, 2), {})   -- empty interval
+  eqT(table.fill({}, 1, maxI - 1, maxI), {[maxI - 1] = 1, [maxI] = 1})
+  eqT(table.fill({}, 1, minI, minI + 1), {[minI] = 1, [minI + 1] = 1})
+  checkerror("bad argument #2", table.fill, {})
+  eqT(table.fill({1, 2, 3}, 0, 2, 5), {1, 0, 0, 0, 0})   -- beyond array
+  eqT(table.fill({1, 2, 3, x = 1}, 0, 0, 1), {[0] = 0, 0, 2, 3, x = 1})
+  a = table.fill(table.create(100), 7, 1, 100)
+  for i = 1, 100 do assert(a[i] == 7) end
+  assert(#a == 100)
+
+  eqT(table.reverse{}, {})
+  eqT(table.reverse{1}, {1})
+  eqT(table.reverse{1, 2, 3, 4}, {4, 3, 2, 1})
+  eqT(table.reverse{1, 2, 3, 4, 5}, {5, 4, 3, 2, 1})
+  eqT(table.reverse({1, 2, 3, 4, 5}, 2, 4), {1, 4, 3, 2, 5})
+  eqT(table.reverse({[maxI - 1] = 1, [maxI] = 2}, maxI - 1, maxI),
+      {[maxI - 1] = 2, [maxI] = 1})
+  eqT(table.reverse({1, 2, 3, [5] = 5}, 1, 5), {5, nil, 3, 2, 1})
+  -- reverse across the array/hash boundary, creating new keys; the
+  -- string is referenced only by the table
+  a = {string.rep("a", 100) .. "x", 2, 3}
+  table.reverse(a, 1, 5)
+  collectgarbage()
+  eqT(a, {nil, nil, 3, 2, string.rep("a", 100) .. "x"})
+  eqT(table.reverse({1, 2, 3, [-1] = -1}, -1, 3), {[-1] = 3, [0] = 2, 1, nil, -1})
+
+  eqT(table.slice{}, {})
+  eqT(table.slice{1, 2, 3}, {1, 2, 3})
+  eqT(table.slice({1, 2, 3, 4, 5}, 2, 4), {2, 3, 4})
+  eqT(table.slice({1, 2, 3}, 3), {3})
+  eqT(table.slice({1, 2, 3}, 4), {})
+  eqT(table.slice({[maxI] = 1}, maxI, maxI), {1})
+  checkerror("too many elements", table.slice, {}, minI, maxI)
+  checkerror("too many elements", table.slice, {}, 1, maxI)
+  eqT(table.slice({1, nil, 3}, 1, 3), {1, nil, 3})
+  eqT(table.slice({[10] = 1, [11] = 2}, 10, 11), {1, 2})
+  eqT(table.slice({1, 2, 3, [4] = 4, [5] = 5}, 2, 5), {2, 3, 4, 5})
+
+  a = {10, 20, 30, x = 1, [-1] = 2, [2.5] = 3, [true] = false}
+  local b = table.copy(a)
+  assert(a ~= b)
+  eqT(a, b)
+  a = setmetatable({1}, {__index = error})
+  b = table.copy(a)
+  assert(getmetatable(b) == nil and b[1] == 1 and b[2] == nil)
+  a = {1, nil, 3, x = 10}
+  b = table.copy(a)
+  b[1] = 0; b.x = 0; b.y = 0
+  eqT(a, {1, nil, 3, x = 10})
+  eqT(b, {0, nil, 3, x = 0, y = 0})
+  checkerror("table expected", table.copy, 1)
+
+  a = {10, 20, 30, 20}
+  assert(table.find(a, 20) == 2)
+  assert(table.find(a, 20, 3) == 4)
+  assert(table.find(a, 10, 2) == nil)
+  assert(table.find(a, 40) == nil)
+  assert(table.find(a, "20") == nil)
+  assert(table.find({1, 2.0, 3}, 2) == 2)
+  assert(table.find({}, nil) == nil)
+  assert(table.find({[maxI] = 1}, 1, maxI) == nil)   -- #t is 0
+  assert(table.find({1, 2, 3, [4] = 4}, 4) == 4)
+  assert(table.find({1, 2, 3, [0] = 3}, 3, 0) == 0)
+
+  -- '__eq' applies to tables and userdata
+  local eqmt = {__eq = function () return true end}
+  a = {1, {}, 3}
+  assert(table.find(a, setmetatable({}, eqmt)) == 2)
+  assert(table.find(a, {}) == nil)
+
+  -- explicit interval ends do not use the length
+  a = setmetatable({}, {__len = function () error("no length") end})
+  eqT(table.fill(a, 1, 1, 2), {1, 1})
+  eqT(table.reverse(a, 1, 2), {1, 1})
+  eqT(table.slice(a, 1, 2), {1, 1})
+
+  -- empty metatable uses the generic path, with the same results
+  a = setmetatable({1, 2, 3, 4}, {})
+  eqT(table.fill(a, 0, 3), {1, 2, 0, 0})
+  eqT(table.reverse(a), {0, 0, 2, 1})
+  eqT(table.slice(a, 2), {0, 2, 1})
+  assert(table.find(a, 2) == 3)
+
+  -- functions respect metamethods
+  local log = {}
+  a = setmetatable({}, {
+        __index = function (_, k) return k * 10 end,
+        __newindex = function (_, k, v) log[#log + 1] = k .. "=" .. v end,
+        __len = function () return 3 end})
+  table.fill(a, 1)
+  assert(table.concat(log, ",") == "1=1,2=1,3=1")
+  eqT(table.slice(a), {10, 20, 30})
+  assert(table.find(a, 20) == 2)
+  log = {}
+  table.reverse(a)
+  assert(table.concat(log, ",") == "1=30,3=10")
+end
+
+
 checkerror("too many", table.move, {}, 0, maxI, 1)
 checkerror("too many", table.move, {}, -1, maxI - 1, 1)
 checkerror("too many", table.move, {}, minI, -1, 1)
@@ -310,6 +473,65 @@ print(string.format("Invert-sorting other %d elements in %.2f msec., with %i com
 check(a, function(x,y) return y<x end)
 
 
+do   -- arrays sorted without the API (integers, floats, or strings)
+  local function checkperm (a, b)
+    local count = {}
+    for i = 1, #a do count[a[i]] = (count[a[i]] or 0) + 1 end
+    for i = 1, #b do count[b[i]] = count[b[i]] - 1 end
+    for _, c in pairs(count) do assert(c == 0) end
+  end
+
+  local function checksort (a)
+    local b = table.move(a, 1, #a, 1, {})
+    table.sort(a)
+    assert(#a == #b)
+    check(a)
+    checkperm(a, b)
+    for i = 2, #a do   -- elements keep their subtypes
+      assert(math.type(a[i]) == math.type(a[1]))
+    end
+  end
+
+  local N = _soft and 500 or 5000
+  local a = {}
+  for i = 1, N do a[i] = math.random(-100, 100) end
+  a[3] = math.maxinteger; a[5] = math.mininteger
+  checksort(a)
+  checksort(a)   -- already sorted
+
+  a = {}
+  for i = 1, N do a[i] = math.random() - 0.5 end
+  a[2] = -0.0; a[4] = 1/0; a[6] = -1/0
+  checksort(a)
+
+  a = {}
+  for i = 1, N do
+    a[i] = string.format("%d\0%d", math.random(100), math.random(100))
+  end
+  a[1] = ""; a[2] = "\0"; a[3] = "\0\0"
+  checksort(a)
+  for i = 1, N do a[i] = string.rep("x", math.random(200)) end
+  checksort(a)
+
+  -- mixed arrays go through the generic sort
+  for i = 1, N do a[i] = (i % 2 == 0) and i or i + 0.5 end
+  table.sort(a)
+  check(a)
+
+  a = {}
+  for i = 1, N do a[i] = i end
+  a[N // 2] = "x"
+  checkerror("attempt to compare", table.sort, a)
+
+  -- arrays with metatables also go through the generic sort
+  a = setmetatable({}, {__index = function (_, k) return -k end,
+                        __len = function () return N end})
+  table.sort(a)
+  check(a)
+  assert(a[1] == -N and a[N] == -1)
+end
+
+
 table.sort{}  -- empty array
 
 for i=1,limit do a[i] = false end